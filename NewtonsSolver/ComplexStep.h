@@ -0,0 +1,66 @@
+#pragma once
+#include <complex>
+#include <vector>
+#include "FiniteDifferences.h"
+
+namespace Newtons {
+
+   /// <summary>
+   /// Матрица Якоби методом комплексного шага. Функции системы задаются шаблоном по типу чисел
+   /// (template &lt;class T&gt; void(const T* x, T* F)) и вычисляются на std::complex&lt;double&gt;:
+   /// df/dx_j = Im f(x + i*h*e_j) / h. Вычитания близких чисел нет, поэтому шаг можно брать
+   /// сколь угодно малым, и производные получаются с машинной точностью за одно вычисление
+   /// функций на столбец. Функции должны быть аналитическими: abs, сравнения и ветвления
+   /// по значениям для комплексных чисел дают неверные производные или не компилируются.
+   /// </summary>
+   template <class TFunctions>
+   class ComplexStepJacobian {
+   private:
+
+      TFunctions _functions;
+      size_t _varCount;
+      size_t _funcCount;
+
+      ValueScratch<std::complex<double>>& _GetScratch() const {
+         ValueScratch<std::complex<double>>& scratch = ThreadScratch<ComplexStepJacobian, ValueScratch<std::complex<double>>>();
+         scratch.x.resize(_varCount);
+         scratch.F.resize(_funcCount);
+         return scratch;
+      }
+
+   public:
+
+      // Мнимый шаг
+      double step = 1e-100;
+
+      /// <summary>
+      /// Инициализатор матрицы Якоби методом комплексного шага
+      /// </summary>
+      /// <param name="variableCount"> - количество переменных в системе</param>
+      /// <param name="funcCount"> - количество функций в системе</param>
+      /// <param name="functions"> - шаблонная функция, считающая все функции системы</param>
+      ComplexStepJacobian(size_t variableCount, size_t funcCount, TFunctions functions)
+         : _functions(std::move(functions)), _varCount(variableCount), _funcCount(funcCount) {}
+
+      // Заполняет матрицу Якоби J (funcCount x variableCount, по строкам) в точке x
+      void operator()(const double* x, double* J) const {
+         ValueScratch<std::complex<double>>& s = _GetScratch();
+         for (size_t var = 0; var < _varCount; var++)
+         {
+            s.x[var] = x[var];
+         }
+
+         for (size_t var = 0; var < _varCount; var++)
+         {
+            s.x[var].imag(step);
+            _functions(static_cast<const std::complex<double>*>(s.x.data()), s.F.data());
+            s.x[var].imag(0.0);
+
+            for (size_t func = 0; func < _funcCount; func++)
+            {
+               J[func * _varCount + var] = s.F[func].imag() / step;
+            }
+         }
+      }
+   };
+}
@@ -0,0 +1,396 @@
+#pragma once
+#include "NewtonsSolver.h"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace Newtons {
+
+   // Способ продолжения по параметру
+   // - NaturalParameter - шаг делается по самому параметру lambda, корректор решает F(x, lambda) = 0
+   //   при фиксированном lambda. В точке поворота dx/dlambda бесконечна, и продолжение там останавливается
+   // - PseudoArclength - шаг делается по длине дуги кривой решений y = (x, lambda), к системе добавляется
+   //   уравнение (t, y - y_pred) = 0, t - касательная в предыдущей точке. Окаймлённая матрица
+   //   в простой точке поворота невырождена, поэтому продолжение проходит её и разворачивается по lambda
+   enum class ContinuationMethod {
+      NaturalParameter,
+      PseudoArclength
+   };
+
+   // Точка кривой решений
+   struct ContinuationPoint {
+      std::vector<double> x;
+      double lambda = 0;
+
+      // Касательная к кривой (dx, dlambda) единичной длины. В Run направлена по ходу продолжения
+      std::vector<double> tangent;
+
+      // Невязка и число итераций корректора
+      double eps = 0;
+      int iterations = 0;
+
+      // Между предыдущей точкой и этой dlambda сменила знак - кривая прошла точку поворота (fold)
+      bool turningPoint = false;
+   };
+
+   /// <summary>
+   /// Продолжение по параметру семейства систем F(x, lambda) = 0 (n функций от n переменных).
+   /// Функции задаются на расширенном векторе y = (x_0, ..., x_{n-1}, lambda): либо вместе с матрицей Якоби
+   /// (void(const double* y, double* F, double* J), J - n x (n + 1) по строкам, последний столбец - dF/dlambda,
+   /// J может быть nullptr), либо только значения (void(const double* y, double* F)) - тогда матрица Якоби
+   /// считается правыми разностями. Каждая следующая точка начинается с предиктора по касательной из предыдущей,
+   /// корректор - BasicNewtonsSolver на окаймлённой системе из n + 1 уравнения: строка окаймления последняя,
+   /// поэтому профиль LU почти не растёт, а касательная в найденной точке решается тем же разложением,
+   /// что оставил корректор. Шаг растёт, пока корректор сходится быстро, и делится пополам при неудаче.
+   /// </summary>
+   template <class TFunctions>
+   class BasicContinuation {
+   private:
+
+      // Окаймлённая система корректора: F(y) и (border, y - anchor) = 0
+      struct _Bordered {
+         BasicContinuation* owner;
+
+         void operator()(const double* y, double* F, double* J) const {
+            owner->_EvalBordered(y, F, J);
+         }
+      };
+
+      struct _NoDifference {};
+      using _Difference = std::conditional_t<FusedResidualJacobian<TFunctions>, _NoDifference, FiniteDifferenceJacobian<TFunctions>>;
+
+      size_t _n;
+      TFunctions _functions;
+      _Difference _difference;
+
+      // Строка окаймления и точка, через которую проходит гиперплоскость корректора (размера n + 1)
+      std::vector<double> _border;
+      std::vector<double> _anchor;
+
+      // Текущая точка, предиктор, касательная и новая касательная (размера n + 1)
+      std::vector<double> _y;
+      std::vector<double> _predicted;
+      std::vector<double> _tangent;
+      std::vector<double> _nextTangent;
+
+      // Окаймлённая матрица, если касательную не удалось найти разложением корректора
+      // (_jacobian и _mat размера (n + 1)^2 выделяются при первом таком случае)
+      std::vector<double> _values;
+      std::vector<double> _jacobian;
+      std::vector<double> _rhs;
+      Matrix _mat;
+      ProfileMatrix _profMat;
+
+      BasicNewtonsSolver<_Bordered, _Bordered> _solver;
+
+      static _Difference _MakeDifference(size_t n, const TFunctions& functions) {
+         if constexpr (FusedResidualJacobian<TFunctions>)
+            return {};
+         else
+            return _Difference(n + 1, n, functions);
+      }
+
+      void _EvalBordered(const double* y, double* F, double* J) {
+         // Первые n строк матрицы (n + 1) x (n + 1) по строкам - это и есть матрица n x (n + 1) семейства
+         if constexpr (FusedResidualJacobian<TFunctions>)
+         {
+            _functions(y, F, J);
+         }
+         else
+         {
+            _functions(y, F);
+            if (J)
+            {
+               _difference(y, F, J);
+            }
+         }
+
+         double sum = 0;
+         for (size_t i = 0; i <= _n; i++)
+         {
+            sum += _border[i] * (y[i] - _anchor[i]);
+         }
+         F[_n] = sum;
+         if (J)
+         {
+            std::copy(_border.begin(), _border.end(), J + _n * (_n + 1));
+         }
+      }
+
+      // Строка окаймления: lambda = const или касательная
+      void _SetBorder(bool natural, const std::vector<double>& tangent) {
+         if (natural)
+         {
+            std::fill(_border.begin(), _border.end(), 0.0);
+            _border[_n] = 1;
+         }
+         else
+         {
+            _border = tangent;
+         }
+      }
+
+      // Корректор из точки y (она же - опорная точка гиперплоскости). Возвращает код Solve
+      int _Correct(std::vector<double>& y, bool natural, double& eps) {
+         _anchor = y;
+         int status = _solver.Solve(y, eps);
+         if (natural)
+         {
+            // Последнее уравнение линейно, lambda остаётся заданной с точностью до округления
+            y[_n] = _anchor[_n];
+         }
+         return status;
+      }
+
+      // Решает [J; border^T] t = e_n в точке y. Если корректор сделал хотя бы одну итерацию, его последнее
+      // разложение - это разложение той же окаймлённой матрицы, и новая матрица не считается.
+      // Возвращает false, если матрица вырождена
+      bool _Tangent(const std::vector<double>& y, bool corrected, std::vector<double>& t) {
+         std::fill(_rhs.begin(), _rhs.end(), 0.0);
+         _rhs[_n] = 1;
+         if (!corrected || !_solver.SolveLastJacobian(_rhs, t))
+         {
+            if (_jacobian.empty())
+            {
+               _jacobian.resize((_n + 1) * (_n + 1));
+               _mat.resize(_n + 1, _n + 1);
+            }
+
+            _EvalBordered(y.data(), _values.data(), _jacobian.data());
+            for (size_t i = 0; i <= _n; i++)
+            {
+               for (size_t j = 0; j <= _n; j++)
+               {
+                  _mat(i, j) = _jacobian[i * (_n + 1) + j];
+               }
+            }
+            _profMat.MakeFromMatrix(_mat);
+            _profMat.LUdecompose();
+            LU::ProfileSolver::Solve(_profMat, t, _rhs);
+         }
+
+         double norm = Vec::Norm(t);
+         return std::isfinite(norm) && norm > 0;
+      }
+
+      // Нормирует касательную, знак sign задаёт направление
+      static void _Normalize(std::vector<double>& t, double sign) {
+         double coef = sign / Vec::Norm(t);
+         for (auto& el : t)
+         {
+            el *= coef;
+         }
+      }
+
+      void _Push(std::vector<ContinuationPoint>& points, const std::vector<double>& tangent, double eps, int iterations, bool turningPoint) const {
+         ContinuationPoint& point = points.emplace_back();
+         point.x.assign(_y.begin(), _y.begin() + _n);
+         point.lambda = _y[_n];
+         point.tangent = tangent;
+         point.eps = eps;
+         point.iterations = iterations;
+         point.turningPoint = turningPoint;
+      }
+
+   public:
+
+      // Способ продолжения, см. ContinuationMethod
+      ContinuationMethod method = ContinuationMethod::PseudoArclength;
+
+      // Начальный, минимальный и максимальный шаг (по lambda или по длине дуги в пространстве (x, lambda))
+      double step = 0.1;
+      double minStep = 1e-6;
+      double maxStep = 1;
+
+      // Если корректор сошёлся не больше чем за fastIterations итераций, шаг умножается на stepGrowth
+      int fastIterations = 3;
+      double stepGrowth = 2;
+
+      // Продолжение в Run останавливается на первой точке, вышедшей за [lambdaMin, lambdaMax],
+      // или после maxPoints точек
+      double lambdaMin = -std::numeric_limits<double>::infinity();
+      double lambdaMax = std::numeric_limits<double>::infinity();
+      size_t maxPoints = 1000;
+
+      /// <summary>
+      /// Инициализатор продолжения по параметру
+      /// </summary>
+      /// <param name="variableCount"> - количество переменных x (и функций) в системе, без параметра</param>
+      /// <param name="functions"> - функции семейства от (x, lambda)</param>
+      BasicContinuation(size_t variableCount, TFunctions functions)
+         : _n(variableCount),
+           _functions(std::move(functions)),
+           _difference(_MakeDifference(variableCount, _functions)),
+           _border(variableCount + 1),
+           _anchor(variableCount + 1),
+           _y(variableCount + 1),
+           _predicted(variableCount + 1),
+           _tangent(variableCount + 1),
+           _nextTangent(variableCount + 1),
+           _values(variableCount + 1),
+           _rhs(variableCount + 1),
+           _solver(variableCount + 1, variableCount + 1, _Bordered{ this })
+      {
+      }
+
+      // Корректор хранит указатель на объект
+      BasicContinuation(const BasicContinuation&) = delete;
+      BasicContinuation& operator=(const BasicContinuation&) = delete;
+
+      // Солвер-корректор: его настройки (minEps, maxIter, stepControl, jacobianUpdate, ...) можно менять
+      BasicNewtonsSolver<_Bordered, _Bordered>& Corrector() {
+         return _solver;
+      }
+
+      // Задаёт структуру матрицы Якоби семейства (n x (n + 1)); строка окаймления считается заполненной
+      void SetSparsity(const JacobianSparsity& sparsity) {
+         if (sparsity.funcCount != _n || sparsity.varCount != _n + 1)
+            throw std::runtime_error("Sparsity pattern size does not match the parameterized system.");
+
+         std::vector<std::vector<size_t>> rowCols(_n + 1);
+         for (size_t func = 0; func < _n; func++)
+         {
+            rowCols[func].assign(sparsity.cols.begin() + sparsity.rowBegin[func], sparsity.cols.begin() + sparsity.rowBegin[func + 1]);
+         }
+         for (size_t var = 0; var <= _n; var++)
+         {
+            rowCols[_n].push_back(var);
+         }
+         _solver.SetSparsity(JacobianSparsity(_n + 1, _n + 1, rowCols));
+      }
+
+      // Строит кривую решений из точки (x0, lambda0): сначала x0 уточняется при lambda0, затем продолжение
+      // идёт в сторону роста lambda (direction > 0) или убывания (direction < 0). Точки записываются в points.
+      // Возможный возврат:
+      // 0 - кривая построена до границы lambda или до maxPoints точек
+      // -1 - шаг стал меньше minStep (для NaturalParameter - обычно точка поворота)
+      // -3 - окаймлённая матрица вырождена (точка ветвления)
+      // Другие отрицательные числа - код Solve, если не удалось найти первую точку
+      int Run(const std::vector<double>& x0, double lambda0, double direction, std::vector<ContinuationPoint>& points) {
+         bool natural = method == ContinuationMethod::NaturalParameter;
+         double sign = direction < 0 ? -1 : 1;
+         points.clear();
+
+         std::copy(x0.begin(), x0.end(), _y.begin());
+         _y[_n] = lambda0;
+         _SetBorder(true, _tangent);
+         double eps;
+         int status = _Correct(_y, true, eps);
+         if (status < 0)
+            return status;
+         if (!_Tangent(_y, status > 0, _tangent))
+            return -3;
+         _Normalize(_tangent, sign);
+         _Push(points, _tangent, eps, status, false);
+
+         double h = step;
+         while (points.size() < maxPoints && _y[_n] >= lambdaMin && _y[_n] <= lambdaMax)
+         {
+            // Для NaturalParameter шаг h - по lambda, вдоль касательной это длина h / |dlambda|
+            double length = natural ? h / std::abs(_tangent[_n]) : h;
+            if (!std::isfinite(length))
+               return -1;
+
+            Vec::AddVec(_y, length, _tangent, _predicted);
+            _SetBorder(natural, _tangent);
+            status = _Correct(_predicted, natural, eps);
+
+            // Корректор, ушедший от предиктора дальше длины шага, скорее всего перескочил на другую ветвь
+            bool accepted = status >= 0;
+            if (accepted)
+            {
+               Vec::AddVec(_predicted, -1, _anchor, _nextTangent);
+               accepted = Vec::Norm(_nextTangent) <= length;
+            }
+            if (accepted)
+            {
+               accepted = _Tangent(_predicted, status > 0, _nextTangent);
+               if (!accepted && !natural)
+                  return -3;
+            }
+            if (!accepted)
+            {
+               h /= 2;
+               if (h < minStep)
+                  return -1;
+               continue;
+            }
+
+            // Для PseudoArclength (t_prev, t) = 1 > 0, направление сохраняется само
+            _Normalize(_nextTangent, natural ? sign : 1);
+            bool turningPoint = _nextTangent[_n] * _tangent[_n] < 0;
+            std::swap(_y, _predicted);
+            std::swap(_tangent, _nextTangent);
+            _Push(points, _tangent, eps, status, turningPoint);
+
+            if (status <= fastIterations)
+            {
+               h = std::min(h * stepGrowth, maxStep);
+            }
+         }
+         return 0;
+      }
+
+      // Решает систему при каждом значении параметра из lambdas по порядку (естественный параметр), каждое
+      // решение начинается с предиктора по касательной из предыдущего. Если корректор не сходится, интервал
+      // до следующего значения проходится меньшими шагами (промежуточные точки в points не попадают).
+      // Возврат - как у Run, при -1 в points лежат решения, найденные до остановки
+      int Sweep(const std::vector<double>& x0, const std::vector<double>& lambdas, std::vector<ContinuationPoint>& points) {
+         points.clear();
+         if (lambdas.empty())
+            return 0;
+
+         std::copy(x0.begin(), x0.end(), _y.begin());
+         _y[_n] = lambdas[0];
+         _SetBorder(true, _tangent);
+         double eps;
+         int status = _Correct(_y, true, eps);
+         if (status < 0)
+            return status;
+         if (!_Tangent(_y, status > 0, _tangent))
+            return -3;
+         _nextTangent = _tangent;
+         _Normalize(_nextTangent, 1);
+         _Push(points, _nextTangent, eps, status, false);
+
+         for (size_t k = 1; k < lambdas.size(); k++)
+         {
+            // Касательная со вторым уравнением lambda = const нормирована на dlambda = 1
+            double target = lambdas[k];
+            double h = target - _y[_n];
+            while (true)
+            {
+               bool last = std::abs(h) >= std::abs(target - _y[_n]);
+               Vec::AddVec(_y, h, _tangent, _predicted);
+               if (last)
+               {
+                  _predicted[_n] = target;
+               }
+               status = _Correct(_predicted, true, eps);
+               if (status >= 0 && _Tangent(_predicted, status > 0, _nextTangent))
+               {
+                  std::swap(_y, _predicted);
+                  std::swap(_tangent, _nextTangent);
+                  if (last)
+                     break;
+                  h = target - _y[_n];
+                  continue;
+               }
+
+               h /= 2;
+               if (std::abs(h) < minStep)
+                  return -1;
+            }
+            _nextTangent = _tangent;
+            _Normalize(_nextTangent, 1);
+            _Push(points, _nextTangent, eps, status, false);
+         }
+         return 0;
+      }
+   };
+
+   template <class TFunctions>
+   BasicContinuation(size_t, TFunctions) -> BasicContinuation<TFunctions>;
+}
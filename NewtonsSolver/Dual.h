@@ -0,0 +1,214 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#include "MathFunctions.h"
+#include "FiniteDifferences.h"
+
+namespace Newtons {
+
+   // Дуальное число для автоматического дифференцирования вперёд: значение и N производных
+   // по N направлениям сразу. Функции, написанные шаблоном по типу чисел, на Dual<N>
+   // вычисляют сразу N столбцов матрицы Якоби
+   template <size_t N>
+   struct Dual {
+      double value{};
+      std::array<double, N> d{};
+
+      Dual() {}
+      Dual(double v) : value(v) {}
+
+      Dual& operator+=(const Dual& r) {
+         value += r.value;
+         for (size_t k = 0; k < N; k++) d[k] += r.d[k];
+         return *this;
+      }
+      Dual& operator-=(const Dual& r) {
+         value -= r.value;
+         for (size_t k = 0; k < N; k++) d[k] -= r.d[k];
+         return *this;
+      }
+      Dual& operator*=(const Dual& r) {
+         for (size_t k = 0; k < N; k++) d[k] = d[k] * r.value + value * r.d[k];
+         value *= r.value;
+         return *this;
+      }
+      Dual& operator/=(const Dual& r) {
+         double inv = 1.0 / r.value;
+         value *= inv;
+         for (size_t k = 0; k < N; k++) d[k] = (d[k] - value * r.d[k]) * inv;
+         return *this;
+      }
+      Dual& operator+=(double r) { value += r; return *this; }
+      Dual& operator-=(double r) { value -= r; return *this; }
+      Dual& operator*=(double r) {
+         value *= r;
+         for (size_t k = 0; k < N; k++) d[k] *= r;
+         return *this;
+      }
+      Dual& operator/=(double r) { return *this *= 1.0 / r; }
+   };
+
+   // Применяет к числу функцию со значением f и производной df в точке a.value
+   template <size_t N>
+   Dual<N> _Chain(const Dual<N>& a, double f, double df) {
+      Dual<N> res(f);
+      for (size_t k = 0; k < N; k++) res.d[k] = df * a.d[k];
+      return res;
+   }
+
+   template <size_t N> Dual<N> operator+(const Dual<N>& a) { return a; }
+   template <size_t N> Dual<N> operator-(const Dual<N>& a) { return _Chain(a, -a.value, -1.0); }
+
+   template <size_t N> Dual<N> operator+(Dual<N> l, const Dual<N>& r) { return l += r; }
+   template <size_t N> Dual<N> operator-(Dual<N> l, const Dual<N>& r) { return l -= r; }
+   template <size_t N> Dual<N> operator*(Dual<N> l, const Dual<N>& r) { return l *= r; }
+   template <size_t N> Dual<N> operator/(Dual<N> l, const Dual<N>& r) { return l /= r; }
+
+   template <size_t N> Dual<N> operator+(Dual<N> l, double r) { return l += r; }
+   template <size_t N> Dual<N> operator-(Dual<N> l, double r) { return l -= r; }
+   template <size_t N> Dual<N> operator*(Dual<N> l, double r) { return l *= r; }
+   template <size_t N> Dual<N> operator/(Dual<N> l, double r) { return l /= r; }
+
+   template <size_t N> Dual<N> operator+(double l, Dual<N> r) { return r += l; }
+   template <size_t N> Dual<N> operator-(double l, const Dual<N>& r) { return -r + l; }
+   template <size_t N> Dual<N> operator*(double l, Dual<N> r) { return r *= l; }
+   template <size_t N> Dual<N> operator/(double l, const Dual<N>& r) { return _Chain(r, l / r.value, -l / (r.value * r.value)); }
+
+   // Сравнения - по значениям (ветвления в функциях работают как для double)
+   template <size_t N> bool operator==(const Dual<N>& l, const Dual<N>& r) { return l.value == r.value; }
+   template <size_t N> bool operator!=(const Dual<N>& l, const Dual<N>& r) { return l.value != r.value; }
+   template <size_t N> bool operator<(const Dual<N>& l, const Dual<N>& r) { return l.value < r.value; }
+   template <size_t N> bool operator>(const Dual<N>& l, const Dual<N>& r) { return l.value > r.value; }
+   template <size_t N> bool operator<=(const Dual<N>& l, const Dual<N>& r) { return l.value <= r.value; }
+   template <size_t N> bool operator>=(const Dual<N>& l, const Dual<N>& r) { return l.value >= r.value; }
+   template <size_t N> bool operator==(const Dual<N>& l, double r) { return l.value == r; }
+   template <size_t N> bool operator!=(const Dual<N>& l, double r) { return l.value != r; }
+   template <size_t N> bool operator<(const Dual<N>& l, double r) { return l.value < r; }
+   template <size_t N> bool operator>(const Dual<N>& l, double r) { return l.value > r; }
+   template <size_t N> bool operator<=(const Dual<N>& l, double r) { return l.value <= r; }
+   template <size_t N> bool operator>=(const Dual<N>& l, double r) { return l.value >= r; }
+   template <size_t N> bool operator==(double l, const Dual<N>& r) { return l == r.value; }
+   template <size_t N> bool operator!=(double l, const Dual<N>& r) { return l != r.value; }
+   template <size_t N> bool operator<(double l, const Dual<N>& r) { return l < r.value; }
+   template <size_t N> bool operator>(double l, const Dual<N>& r) { return l > r.value; }
+   template <size_t N> bool operator<=(double l, const Dual<N>& r) { return l <= r.value; }
+   template <size_t N> bool operator>=(double l, const Dual<N>& r) { return l >= r.value; }
+
+   template <size_t N> Dual<N> sqrt(const Dual<N>& a) {
+      double s = std::sqrt(a.value);
+      return _Chain(a, s, 0.5 / s);
+   }
+   template <size_t N> Dual<N> exp(const Dual<N>& a) {
+      double e = std::exp(a.value);
+      return _Chain(a, e, e);
+   }
+   template <size_t N> Dual<N> log(const Dual<N>& a) { return _Chain(a, std::log(a.value), 1.0 / a.value); }
+   template <size_t N> Dual<N> sin(const Dual<N>& a) { return _Chain(a, std::sin(a.value), std::cos(a.value)); }
+   template <size_t N> Dual<N> cos(const Dual<N>& a) { return _Chain(a, std::cos(a.value), -std::sin(a.value)); }
+   template <size_t N> Dual<N> tan(const Dual<N>& a) {
+      double t = std::tan(a.value);
+      return _Chain(a, t, 1.0 + t * t);
+   }
+   template <size_t N> Dual<N> asin(const Dual<N>& a) { return _Chain(a, std::asin(a.value), 1.0 / std::sqrt(1.0 - a.value * a.value)); }
+   template <size_t N> Dual<N> acos(const Dual<N>& a) { return _Chain(a, std::acos(a.value), -1.0 / std::sqrt(1.0 - a.value * a.value)); }
+   template <size_t N> Dual<N> atan(const Dual<N>& a) { return _Chain(a, std::atan(a.value), 1.0 / (1.0 + a.value * a.value)); }
+   template <size_t N> Dual<N> sinh(const Dual<N>& a) { return _Chain(a, std::sinh(a.value), std::cosh(a.value)); }
+   template <size_t N> Dual<N> cosh(const Dual<N>& a) { return _Chain(a, std::cosh(a.value), std::sinh(a.value)); }
+   template <size_t N> Dual<N> tanh(const Dual<N>& a) {
+      double t = std::tanh(a.value);
+      return _Chain(a, t, 1.0 - t * t);
+   }
+   template <size_t N> Dual<N> abs(const Dual<N>& a) { return a.value < 0 ? -a : a; }
+   template <size_t N> Dual<N> fabs(const Dual<N>& a) { return abs(a); }
+
+   template <size_t N> Dual<N> pow(const Dual<N>& a, double p) {
+      if (p == 0) return Dual<N>(1.0);
+      double f = std::pow(a.value, p);
+      return _Chain(a, f, p * std::pow(a.value, p - 1));
+   }
+   template <size_t N> Dual<N> pow(double a, const Dual<N>& p) {
+      double f = std::pow(a, p.value);
+      return _Chain(p, f, f * std::log(a));
+   }
+   template <size_t N> Dual<N> pow(const Dual<N>& a, const Dual<N>& p) {
+      return exp(p * log(a));
+   }
+   template <size_t N> Dual<N> atan2(const Dual<N>& y, const Dual<N>& x) {
+      double r2 = x.value * x.value + y.value * y.value;
+      Dual<N> res(std::atan2(y.value, x.value));
+      for (size_t k = 0; k < N; k++) res.d[k] = (x.value * y.d[k] - y.value * x.d[k]) / r2;
+      return res;
+   }
+
+
+   /// <summary>
+   /// Матрица Якоби автоматическим дифференцированием вперёд. Функции системы задаются одной
+   /// шаблонной функцией по типу чисел: template &lt;class T&gt; void(const T* x, T* F) (например,
+   /// обобщённой лямбдой [](const auto* x, auto* F)). Функции вычисляются на Dual&lt;N&gt;, и каждое
+   /// вычисление даёт сразу N точных столбцов, то есть на матрицу нужно ceil(n / N) вычислений.
+   /// Объект подходит солверу в качестве функции дифференциалов, а сами функции - в качестве функций.
+   /// </summary>
+   template <class TFunctions, size_t N = 8>
+   class AutoDiffJacobian {
+   private:
+
+      TFunctions _functions;
+      size_t _varCount;
+      size_t _funcCount;
+
+      ValueScratch<Dual<N>>& _GetScratch() const {
+         ValueScratch<Dual<N>>& scratch = ThreadScratch<AutoDiffJacobian, ValueScratch<Dual<N>>>();
+         scratch.x.resize(_varCount);
+         scratch.F.resize(_funcCount);
+         return scratch;
+      }
+
+   public:
+
+      /// <summary>
+      /// Инициализатор матрицы Якоби автоматическим дифференцированием
+      /// </summary>
+      /// <param name="variableCount"> - количество переменных в системе</param>
+      /// <param name="funcCount"> - количество функций в системе</param>
+      /// <param name="functions"> - шаблонная функция, считающая все функции системы</param>
+      AutoDiffJacobian(size_t variableCount, size_t funcCount, TFunctions functions)
+         : _functions(std::move(functions)), _varCount(variableCount), _funcCount(funcCount) {}
+
+      // Заполняет матрицу Якоби J (funcCount x variableCount, по строкам) в точке x
+      void operator()(const double* x, double* J) const {
+         ValueScratch<Dual<N>>& s = _GetScratch();
+         for (size_t var = 0; var < _varCount; var++)
+         {
+            s.x[var] = Dual<N>(x[var]);
+         }
+
+         for (size_t first = 0; first < _varCount; first += N)
+         {
+            size_t count = std::min(N, _varCount - first);
+
+            // Направления - единичные векторы переменных first ... first + count - 1
+            for (size_t k = 0; k < count; k++)
+            {
+               s.x[first + k].d[k] = 1.0;
+            }
+
+            _functions(static_cast<const Dual<N>*>(s.x.data()), s.F.data());
+
+            for (size_t func = 0; func < _funcCount; func++)
+            {
+               for (size_t k = 0; k < count; k++)
+               {
+                  J[func * _varCount + first + k] = s.F[func].d[k];
+               }
+            }
+
+            for (size_t k = 0; k < count; k++)
+            {
+               s.x[first + k].d[k] = 0.0;
+            }
+         }
+      }
+   };
+}
@@ -0,0 +1,608 @@
+#include "Expression.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define NEWTONS_EXPR_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NEWTONS_EXPR_SSE2
+#endif
+
+namespace Newtons {
+
+   namespace {
+
+      const std::map<std::string, ExprOp> _unaryFunctions = {
+         { "sqrt", ExprOp::Sqrt }, { "exp", ExprOp::Exp }, { "log", ExprOp::Log },
+         { "sin", ExprOp::Sin }, { "cos", ExprOp::Cos }, { "tan", ExprOp::Tan },
+         { "asin", ExprOp::Asin }, { "acos", ExprOp::Acos }, { "atan", ExprOp::Atan },
+         { "sinh", ExprOp::Sinh }, { "cosh", ExprOp::Cosh }, { "tanh", ExprOp::Tanh },
+         { "abs", ExprOp::Abs }
+      };
+
+      const std::map<std::string, ExprOp> _binaryFunctions = {
+         { "pow", ExprOp::Pow }, { "atan2", ExprOp::Atan2 }
+      };
+
+      // Разбор одной строки описания системы рекурсивным спуском:
+      //   expr  = term {(+|-) term}
+      //   term  = unary {(*|/) unary}
+      //   unary = -unary | power
+      //   power = primary [^ unary]
+      //   primary = число | имя | функция(expr [, expr]) | (expr)
+      class _Parser {
+      private:
+
+         const std::string& _text;
+         size_t _pos = 0;
+         size_t _line;
+         ExprGraph& _graph;
+         const std::map<std::string, std::uint32_t>& _names;
+
+         void _SkipSpaces() {
+            while (_pos < _text.size() && std::isspace(static_cast<unsigned char>(_text[_pos])))
+            {
+               _pos++;
+            }
+         }
+
+         bool _Accept(char c) {
+            _SkipSpaces();
+            if (_pos < _text.size() && _text[_pos] == c)
+            {
+               _pos++;
+               return true;
+            }
+            return false;
+         }
+
+         void _Expect(char c) {
+            if (!_Accept(c))
+               Fail(std::string("expected '") + c + "'");
+         }
+
+         std::uint32_t _Expr() {
+            std::uint32_t left = _Term();
+            while (true)
+            {
+               if (_Accept('+')) left = _graph.Add(ExprOp::Add, left, _Term());
+               else if (_Accept('-')) left = _graph.Add(ExprOp::Sub, left, _Term());
+               else return left;
+            }
+         }
+
+         std::uint32_t _Term() {
+            std::uint32_t left = _Unary();
+            while (true)
+            {
+               if (_Accept('*')) left = _graph.Add(ExprOp::Mul, left, _Unary());
+               else if (_Accept('/')) left = _graph.Add(ExprOp::Div, left, _Unary());
+               else return left;
+            }
+         }
+
+         std::uint32_t _Unary() {
+            if (_Accept('-'))
+               return _graph.Add(ExprOp::Neg, _Unary());
+            if (_Accept('+'))
+               return _Unary();
+            return _Power();
+         }
+
+         std::uint32_t _Power() {
+            std::uint32_t base = _Primary();
+            if (_Accept('^'))
+               return _graph.Add(ExprOp::Pow, base, _Unary());
+            return base;
+         }
+
+         std::uint32_t _Primary() {
+            _SkipSpaces();
+            if (_pos >= _text.size())
+               Fail("unexpected end of expression");
+
+            if (_Accept('('))
+            {
+               std::uint32_t node = _Expr();
+               _Expect(')');
+               return node;
+            }
+
+            char c = _text[_pos];
+            if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+            {
+               // from_chars не зависит от локали, в отличие от strtod
+               const char* begin = _text.data() + _pos;
+               double value = 0;
+               auto [end, error] = std::from_chars(begin, _text.data() + _text.size(), value);
+               if (error != std::errc())
+                  Fail("invalid number");
+               _pos += end - begin;
+               return _graph.Const(value);
+            }
+
+            std::string name = Name();
+            if (name.empty())
+               Fail(std::string("unexpected symbol '") + c + "'");
+
+            if (_Accept('('))
+            {
+               if (auto it = _unaryFunctions.find(name); it != _unaryFunctions.end())
+               {
+                  std::uint32_t arg = _Expr();
+                  _Expect(')');
+                  return _graph.Add(it->second, arg);
+               }
+               if (auto it = _binaryFunctions.find(name); it != _binaryFunctions.end())
+               {
+                  std::uint32_t a = _Expr();
+                  _Expect(',');
+                  std::uint32_t b = _Expr();
+                  _Expect(')');
+                  return _graph.Add(it->second, a, b);
+               }
+               Fail("unknown function '" + name + "'");
+            }
+
+            if (auto it = _names.find(name); it != _names.end())
+               return it->second;
+            if (name == "pi")
+               return _graph.Const(3.14159265358979323846);
+            if (name == "e")
+               return _graph.Const(2.71828182845904523536);
+            Fail("unknown name '" + name + "'");
+            return 0;
+         }
+
+      public:
+
+         _Parser(const std::string& text, size_t line, ExprGraph& graph, const std::map<std::string, std::uint32_t>& names)
+            : _text(text), _line(line), _graph(graph), _names(names) {}
+
+         [[noreturn]] void Fail(const std::string& message) const {
+            throw std::runtime_error("Expression error at line " + std::to_string(_line) + ": " + message + ".");
+         }
+
+         bool AtEnd() {
+            _SkipSpaces();
+            return _pos >= _text.size();
+         }
+
+         std::string Name() {
+            _SkipSpaces();
+            size_t begin = _pos;
+            while (_pos < _text.size() && (std::isalnum(static_cast<unsigned char>(_text[_pos])) || _text[_pos] == '_'))
+            {
+               if (_pos == begin && std::isdigit(static_cast<unsigned char>(_text[_pos])))
+                  break;
+               _pos++;
+            }
+            return _text.substr(begin, _pos - begin);
+         }
+
+         bool Accept(char c) {
+            return _Accept(c);
+         }
+
+         std::uint32_t Expr() {
+            return _Expr();
+         }
+
+         void End() {
+            if (!AtEnd())
+               Fail(std::string("unexpected symbol '") + _text[_pos] + "'");
+         }
+
+         // Выражение до конца строки
+         std::uint32_t Full() {
+            std::uint32_t node = _Expr();
+            End();
+            return node;
+         }
+      };
+
+      // Значение операции над a и b
+      inline double _Apply(ExprOp op, double a, double b) {
+         switch (op)
+         {
+         case ExprOp::Add: return a + b;
+         case ExprOp::Sub: return a - b;
+         case ExprOp::Mul: return a * b;
+         case ExprOp::Div: return a / b;
+         case ExprOp::Pow: return std::pow(a, b);
+         case ExprOp::Atan2: return std::atan2(a, b);
+         case ExprOp::Neg: return -a;
+         case ExprOp::Sqrt: return std::sqrt(a);
+         case ExprOp::Exp: return std::exp(a);
+         case ExprOp::Log: return std::log(a);
+         case ExprOp::Sin: return std::sin(a);
+         case ExprOp::Cos: return std::cos(a);
+         case ExprOp::Tan: return std::tan(a);
+         case ExprOp::Asin: return std::asin(a);
+         case ExprOp::Acos: return std::acos(a);
+         case ExprOp::Atan: return std::atan(a);
+         case ExprOp::Sinh: return std::sinh(a);
+         case ExprOp::Cosh: return std::cosh(a);
+         case ExprOp::Tanh: return std::tanh(a);
+         case ExprOp::Abs: return std::abs(a);
+         default: return 0;
+         }
+      }
+
+      constexpr size_t _lanes = ExprProgram::batchLanes;
+
+      // d = op(a, b) для всех полос. Арифметика - SIMD-командами, остальные функции - по полосам
+      inline void _ApplyLanes(ExprOp op, double* d, const double* a, const double* b) {
+         switch (op)
+         {
+#if defined(NEWTONS_EXPR_AVX)
+         case ExprOp::Add: _mm256_storeu_pd(d, _mm256_add_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b))); return;
+         case ExprOp::Sub: _mm256_storeu_pd(d, _mm256_sub_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b))); return;
+         case ExprOp::Mul: _mm256_storeu_pd(d, _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b))); return;
+         case ExprOp::Div: _mm256_storeu_pd(d, _mm256_div_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b))); return;
+         case ExprOp::Sqrt: _mm256_storeu_pd(d, _mm256_sqrt_pd(_mm256_loadu_pd(a))); return;
+#elif defined(NEWTONS_EXPR_SSE2)
+         case ExprOp::Add:
+            _mm_storeu_pd(d, _mm_add_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+            _mm_storeu_pd(d + 2, _mm_add_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+            return;
+         case ExprOp::Sub:
+            _mm_storeu_pd(d, _mm_sub_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+            _mm_storeu_pd(d + 2, _mm_sub_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+            return;
+         case ExprOp::Mul:
+            _mm_storeu_pd(d, _mm_mul_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+            _mm_storeu_pd(d + 2, _mm_mul_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+            return;
+         case ExprOp::Div:
+            _mm_storeu_pd(d, _mm_div_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+            _mm_storeu_pd(d + 2, _mm_div_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+            return;
+         case ExprOp::Sqrt:
+            _mm_storeu_pd(d, _mm_sqrt_pd(_mm_loadu_pd(a)));
+            _mm_storeu_pd(d + 2, _mm_sqrt_pd(_mm_loadu_pd(a + 2)));
+            return;
+#endif
+         default:
+            for (size_t k = 0; k < _lanes; k++)
+            {
+               d[k] = _Apply(op, a[k], b[k]);
+            }
+            return;
+         }
+      }
+   }
+
+   std::uint32_t ExprGraph::_Intern(ExprOp op, std::uint32_t a, std::uint32_t b, double value) {
+      // -0 и 0 равны, но хэши у них разные
+      _Key key{ op, a, b, value + 0.0 };
+      auto [it, inserted] = _index.emplace(key, static_cast<std::uint32_t>(nodes.size()));
+      if (inserted)
+      {
+         nodes.push_back(ExprNode{ op, a, b, key.value });
+      }
+      return it->second;
+   }
+
+   std::uint32_t ExprGraph::Add(ExprOp op, std::uint32_t a, std::uint32_t b, double value) {
+      if (op == ExprOp::Const)
+         return _Intern(op, 0, 0, value);
+      if (op == ExprOp::Var)
+         return _Intern(op, a, 0, 0);
+
+      bool binary = op < ExprOp::Neg;
+      if (!binary)
+      {
+         b = 0;
+      }
+
+      // Свёртка констант
+      if (nodes[a].op == ExprOp::Const && (!binary || nodes[b].op == ExprOp::Const))
+         return Const(_Apply(op, nodes[a].value, binary ? nodes[b].value : 0));
+
+      switch (op)
+      {
+      case ExprOp::Add:
+         if (IsConst(a, 0)) return b;
+         if (IsConst(b, 0)) return a;
+         if (a > b) std::swap(a, b);
+         break;
+      case ExprOp::Sub:
+         if (IsConst(b, 0)) return a;
+         if (IsConst(a, 0)) return Add(ExprOp::Neg, b);
+         if (a == b) return Const(0);
+         break;
+      case ExprOp::Mul:
+         if (IsConst(a, 0) || IsConst(b, 0)) return Const(0);
+         if (IsConst(a, 1)) return b;
+         if (IsConst(b, 1)) return a;
+         if (IsConst(a, -1)) return Add(ExprOp::Neg, b);
+         if (IsConst(b, -1)) return Add(ExprOp::Neg, a);
+         if (a > b) std::swap(a, b);
+         break;
+      case ExprOp::Div:
+         if (IsConst(a, 0)) return Const(0);
+         if (IsConst(b, 1)) return a;
+         if (a == b) return Const(1);
+         break;
+      case ExprOp::Pow:
+         if (IsConst(b, 0)) return Const(1);
+         if (IsConst(b, 1)) return a;
+         if (IsConst(b, 2)) return Add(ExprOp::Mul, a, a);
+         break;
+      case ExprOp::Neg:
+         if (nodes[a].op == ExprOp::Neg) return nodes[a].a;
+         break;
+      default:
+         break;
+      }
+
+      return _Intern(op, a, b, 0);
+   }
+
+   ExpressionSystem ExpressionSystem::Parse(const std::string& text) {
+      ExpressionSystem system;
+
+      // Имена переменных и промежуточных выражений - номера их узлов в графе
+      std::map<std::string, std::uint32_t> names;
+
+      std::istringstream stream(text);
+      std::string line;
+      for (size_t lineNum = 1; std::getline(stream, line); lineNum++)
+      {
+         line = line.substr(0, line.find('#'));
+         _Parser parser(line, lineNum, system.graph, names);
+         if (parser.AtEnd())
+            continue;
+
+         // Ключевые слова проверяем по первому слову строки
+         _Parser head(line, lineNum, system.graph, names);
+         std::string word = head.Name();
+
+         if (word == "var")
+         {
+            if (!system.equations.empty())
+               head.Fail("variables should be declared before equations");
+
+            while (!head.AtEnd())
+            {
+               std::string name = head.Name();
+               if (name.empty())
+                  head.Fail("expected variable name");
+               if (names.count(name))
+                  head.Fail("name '" + name + "' is already defined");
+
+               names[name] = system.graph.Var(static_cast<std::uint32_t>(system.variables.size()));
+               system.variables.push_back(name);
+               head.Accept(',');
+            }
+         }
+         else if (word == "let")
+         {
+            std::string name = head.Name();
+            if (name.empty())
+               head.Fail("expected name");
+            if (names.count(name))
+               head.Fail("name '" + name + "' is already defined");
+            if (!head.Accept('='))
+               head.Fail("expected '='");
+
+            names[name] = head.Full();
+         }
+         else
+         {
+            std::uint32_t left = parser.Expr();
+            if (parser.Accept('='))
+            {
+               left = system.graph.Add(ExprOp::Sub, left, parser.Full());
+            }
+            else
+            {
+               parser.End();
+            }
+            system.equations.push_back(left);
+         }
+      }
+
+      if (system.equations.empty())
+         throw std::runtime_error("Expression system has no equations.");
+
+      return system;
+   }
+
+   ExpressionSystem ExpressionSystem::Load(const std::string& path) {
+      std::ifstream file(path);
+      if (!file)
+         throw std::runtime_error("Cannot open expression system file '" + path + "'.");
+
+      std::stringstream text;
+      text << file.rdbuf();
+      return Parse(text.str());
+   }
+
+   ExprProgram::ExprProgram(const ExprGraph& graph, size_t inputCount, const std::vector<std::uint32_t>& outputs)
+      : _inputCount(inputCount)
+   {
+      const std::vector<ExprNode>& nodes = graph.nodes;
+      constexpr std::uint32_t none = UINT32_MAX;
+
+      // Нужные узлы и последний узел, использующий значение каждого из них
+      std::vector<bool> used(nodes.size());
+      std::vector<std::uint32_t> lastUse(nodes.size(), 0);
+      for (std::uint32_t out : outputs)
+      {
+         used[out] = true;
+         lastUse[out] = none;
+      }
+      for (size_t i = nodes.size(); i-- > 0; )
+      {
+         if (!used[i])
+            continue;
+
+         const ExprNode& node = nodes[i];
+         if (node.op == ExprOp::Var)
+         {
+            if (node.a >= inputCount)
+               throw std::runtime_error("Expression refers to an input out of range.");
+            continue;
+         }
+         if (node.op == ExprOp::Const)
+            continue;
+
+         // Узлы просматриваются с конца, поэтому первый встреченный узел-пользователь - последний
+         auto use = [&](std::uint32_t arg) {
+            if (!used[arg])
+            {
+               used[arg] = true;
+               lastUse[arg] = static_cast<std::uint32_t>(i);
+            }
+         };
+         use(node.a);
+         if (node.op < ExprOp::Neg)
+         {
+            use(node.b);
+         }
+      }
+
+      // Регистры: входы, затем константы (одинаковые числа - в одном регистре)
+      std::vector<std::uint32_t> reg(nodes.size(), none);
+      std::map<double, std::uint32_t> constRegs;
+      std::uint32_t next = static_cast<std::uint32_t>(inputCount);
+      for (size_t i = 0; i < nodes.size(); i++)
+      {
+         if (!used[i])
+            continue;
+
+         const ExprNode& node = nodes[i];
+         if (node.op == ExprOp::Var)
+         {
+            reg[i] = node.a;
+         }
+         else if (node.op == ExprOp::Const)
+         {
+            auto [it, inserted] = constRegs.emplace(node.value, next);
+            if (inserted)
+            {
+               _constants.emplace_back(next++, node.value);
+            }
+            reg[i] = it->second;
+         }
+      }
+
+      // Промежуточные значения: регистр аргумента освобождается после его последнего использования
+      // и может сразу стать регистром результата (операции поэлементные, это безопасно)
+      std::uint32_t firstTemp = next;
+      std::vector<std::uint32_t> free;
+      for (size_t i = 0; i < nodes.size(); i++)
+      {
+         const ExprNode& node = nodes[i];
+         if (!used[i] || node.op == ExprOp::Var || node.op == ExprOp::Const)
+            continue;
+
+         bool binary = node.op < ExprOp::Neg;
+         Instruction ins{ node.op, 0, reg[node.a], binary ? reg[node.b] : reg[node.a] };
+
+         auto release = [&](std::uint32_t arg) {
+            if (lastUse[arg] == i && reg[arg] >= firstTemp)
+            {
+               free.push_back(reg[arg]);
+            }
+         };
+         release(node.a);
+         if (binary && node.b != node.a)
+         {
+            release(node.b);
+         }
+
+         if (free.empty())
+         {
+            reg[i] = next++;
+         }
+         else
+         {
+            reg[i] = free.back();
+            free.pop_back();
+         }
+         ins.dst = reg[i];
+         _code.push_back(ins);
+      }
+
+      _registerCount = next;
+      for (std::uint32_t out : outputs)
+      {
+         _outputs.push_back(reg[out]);
+      }
+   }
+
+   void ExprProgram::Evaluate(const double* x, double* out) const {
+      thread_local std::vector<double> registers;
+      if (registers.size() < _registerCount)
+      {
+         registers.resize(_registerCount);
+      }
+      double* r = registers.data();
+
+      std::copy(x, x + _inputCount, r);
+      for (const auto& [index, value] : _constants)
+      {
+         r[index] = value;
+      }
+
+      for (const Instruction& ins : _code)
+      {
+         r[ins.dst] = _Apply(ins.op, r[ins.a], r[ins.b]);
+      }
+
+      for (size_t k = 0; k < _outputs.size(); k++)
+      {
+         out[k] = r[_outputs[k]];
+      }
+   }
+
+   void ExprProgram::EvaluateBatch(const double* x, size_t count, double* out) const {
+      thread_local std::vector<double> registers;
+      if (registers.size() < _registerCount * _lanes)
+      {
+         registers.resize(_registerCount * _lanes);
+      }
+      double* r = registers.data();
+
+      // Константы не перезаписываются, поэтому заполняются один раз
+      for (const auto& [index, value] : _constants)
+      {
+         std::fill(r + index * _lanes, r + (index + 1) * _lanes, value);
+      }
+
+      for (size_t first = 0; first < count; first += _lanes)
+      {
+         // Последняя неполная группа дополняется последней точкой
+         size_t valid = std::min(_lanes, count - first);
+         for (size_t var = 0; var < _inputCount; var++)
+         {
+            for (size_t k = 0; k < _lanes; k++)
+            {
+               r[var * _lanes + k] = x[var * count + first + std::min(k, valid - 1)];
+            }
+         }
+
+         for (const Instruction& ins : _code)
+         {
+            _ApplyLanes(ins.op, r + ins.dst * _lanes, r + ins.a * _lanes, r + ins.b * _lanes);
+         }
+
+         for (size_t k = 0; k < _outputs.size(); k++)
+         {
+            std::copy(r + _outputs[k] * _lanes, r + _outputs[k] * _lanes + valid, out + k * count + first);
+         }
+      }
+   }
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Newtons {
+
+   // Операции выражений. Const - число value, Var - переменная с номером a,
+   // остальные - функции одного (a) или двух (a, b) аргументов
+   enum class ExprOp : std::uint8_t {
+      Const, Var,
+      Add, Sub, Mul, Div, Pow, Atan2,
+      Neg, Sqrt, Exp, Log, Sin, Cos, Tan, Asin, Acos, Atan, Sinh, Cosh, Tanh, Abs
+   };
+
+   // Узел графа выражений. Аргументы узла всегда записаны в графе раньше него самого
+   struct ExprNode {
+      ExprOp op = ExprOp::Const;
+      std::uint32_t a = 0;
+      std::uint32_t b = 0;
+      double value = 0;
+   };
+
+   // Граф выражений: узлы в порядке вычисления. Узлы упрощаются при добавлении (свёртка констант,
+   // x + 0, x * 1, x - x, ...), а одинаковые выражения хранятся одним узлом, поэтому общие
+   // подвыражения всех выражений графа вычисляются один раз
+   class ExprGraph {
+   private:
+
+      struct _Key {
+         ExprOp op;
+         std::uint32_t a;
+         std::uint32_t b;
+         double value;
+
+         bool operator==(const _Key& other) const {
+            return op == other.op && a == other.a && b == other.b && value == other.value;
+         }
+      };
+
+      struct _KeyHash {
+         size_t operator()(const _Key& key) const {
+            size_t h = std::hash<double>()(key.value);
+            h = h * 31 + static_cast<size_t>(key.op);
+            h = h * 1000003 + key.a;
+            return h * 1000003 + key.b;
+         }
+      };
+
+      std::unordered_map<_Key, std::uint32_t, _KeyHash> _index;
+
+      std::uint32_t _Intern(ExprOp op, std::uint32_t a, std::uint32_t b, double value);
+
+   public:
+
+      std::vector<ExprNode> nodes;
+
+      // Добавляет узел (или находит такой же), возвращает его номер
+      std::uint32_t Add(ExprOp op, std::uint32_t a = 0, std::uint32_t b = 0, double value = 0);
+
+      std::uint32_t Const(double value) {
+         return Add(ExprOp::Const, 0, 0, value);
+      }
+
+      std::uint32_t Var(std::uint32_t var) {
+         return Add(ExprOp::Var, var);
+      }
+
+      // Узел - число value
+      bool IsConst(std::uint32_t node, double value) const {
+         return nodes[node].op == ExprOp::Const && nodes[node].value == value;
+      }
+   };
+
+   /// <summary>
+   /// Система уравнений, заданная текстом. Формат (по строке на объявление, # - комментарий):
+   ///   var x y                   - переменные системы в порядке их номеров
+   ///   let r2 = x^2 + y^2        - промежуточное выражение, которое можно использовать ниже
+   ///   r2 = 4                    - уравнение (левая часть минус правая)
+   ///   sin(x) - y                - уравнение, равное нулю
+   /// Доступны + - * / ^, скобки, числа (в том числе 1e-3), константы pi и e, функции
+   /// sqrt, exp, log, sin, cos, tan, asin, acos, atan, sinh, cosh, tanh, abs, pow(a, b), atan2(y, x).
+   /// </summary>
+   class ExpressionSystem {
+   public:
+
+      std::vector<std::string> variables;
+      ExprGraph graph;
+
+      // Узлы графа, соответствующие функциям F_j системы
+      std::vector<std::uint32_t> equations;
+
+      size_t VarCount() const {
+         return variables.size();
+      }
+
+      size_t FuncCount() const {
+         return equations.size();
+      }
+
+      // Разбирает систему из текста, при ошибке бросает std::runtime_error с номером строки
+      static ExpressionSystem Parse(const std::string& text);
+
+      // Читает систему из файла
+      static ExpressionSystem Load(const std::string& path);
+   };
+
+   /// <summary>
+   /// Регистровая программа для вычисления набора выражений. Первые inputCount регистров - входы,
+   /// за ними - константы, остальные переиспользуются промежуточными значениями, как только
+   /// значение больше не нужно, поэтому регистров обычно намного меньше, чем узлов графа.
+   /// Программа считает выражения в одной точке (Evaluate) или сразу во многих (EvaluateBatch),
+   /// в последнем случае по batchLanes точек в SIMD-полосах на каждую инструкцию.
+   /// Объект подходит солверу в качестве функций системы: void(const double* x, double* F).
+   /// </summary>
+   class ExprProgram {
+   public:
+
+      struct Instruction {
+         ExprOp op;
+         std::uint32_t dst;
+         std::uint32_t a;
+         std::uint32_t b;
+      };
+
+      // Число точек, обрабатываемых одной инструкцией в EvaluateBatch
+      static constexpr size_t batchLanes = 4;
+
+   private:
+
+      size_t _inputCount = 0;
+      size_t _registerCount = 0;
+      std::vector<std::pair<std::uint32_t, double>> _constants;
+      std::vector<Instruction> _code;
+      std::vector<std::uint32_t> _outputs;
+
+   public:
+
+      ExprProgram() {}
+
+      /// <summary>
+      /// Компилирует выражения графа в программу
+      /// </summary>
+      /// <param name="graph"> - граф выражений</param>
+      /// <param name="inputCount"> - количество входов (узлы Var с номерами 0 ... inputCount - 1)</param>
+      /// <param name="outputs"> - узлы графа, значения которых нужно вычислить</param>
+      ExprProgram(const ExprGraph& graph, size_t inputCount, const std::vector<std::uint32_t>& outputs);
+
+      // Программа для всех функций системы
+      explicit ExprProgram(const ExpressionSystem& system)
+         : ExprProgram(system.graph, system.VarCount(), system.equations) {}
+
+      size_t InputCount() const {
+         return _inputCount;
+      }
+
+      size_t OutputCount() const {
+         return _outputs.size();
+      }
+
+      size_t RegisterCount() const {
+         return _registerCount;
+      }
+
+      const std::vector<Instruction>& Code() const {
+         return _code;
+      }
+
+      // Значения выражений out в точке x
+      void Evaluate(const double* x, double* out) const;
+
+      // Значения выражений в count точках. Входы и выходы хранятся по переменным:
+      // x[var * count + p] - переменная var точки p, out[k * count + p] - выражение k в точке p
+      void EvaluateBatch(const double* x, size_t count, double* out) const;
+
+      void operator()(const double* x, double* F) const {
+         Evaluate(x, F);
+      }
+   };
+}
@@ -0,0 +1,431 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <limits>
+#include <vector>
+#include "Sparsity.h"
+
+namespace Newtons {
+
+   // Разностная схема для численной матрицы Якоби
+   // - Forward - правая разность, n вычислений функций на матрицу (если значения в x известны)
+   // - Central - центральная разность, 2n вычислений
+   // - Richardson - экстраполяция Ричардсона по центральным разностям с шагами h и h/2, 4n вычислений
+   enum class DifferenceScheme {
+      Forward,
+      Central,
+      Richardson
+   };
+
+   // Шаг по переменной var в точке x: relativeStep * max(|x_var|, typicalX[var]) со знаком x_var.
+   // При relativeStep <= 0 шаг выбирается по схеме
+   inline double DifferenceStep(
+      DifferenceScheme scheme,
+      double relativeStep,
+      const std::vector<double>& typicalX,
+      const double* x,
+      size_t var)
+   {
+      double eps = std::numeric_limits<double>::epsilon();
+      double step = relativeStep;
+      if (step <= 0)
+      {
+         switch (scheme)
+         {
+            case DifferenceScheme::Forward: step = std::sqrt(eps); break;
+            case DifferenceScheme::Central: step = std::cbrt(eps); break;
+            case DifferenceScheme::Richardson: step = std::pow(eps, 0.2); break;
+         }
+      }
+
+      double typical = var < typicalX.size() ? typicalX[var] : 1.0;
+      double h = step * std::max(std::abs(x[var]), typical);
+      return x[var] < 0 ? -h : h;
+   }
+
+   // Значения всех функций системы в точке x (функции заданы по одной или все сразу)
+   template <class TFunctions>
+   void EvaluateFunctions(const TFunctions& functions, size_t funcCount, const std::vector<double>& x, std::vector<double>& values) {
+      if constexpr (std::invocable<const TFunctions&, const double*, double*>)
+      {
+         functions(x.data(), values.data());
+      }
+      else
+      {
+         for (size_t i = 0; i < funcCount; i++)
+         {
+            values[i] = functions(i, x);
+         }
+      }
+   }
+
+   // Рабочие векторы одного потока. Набор свой у каждого потока и у каждого типа вычислителя Owner,
+   // поэтому один объект можно вызывать из нескольких потоков; размеры задаёт сам вычислитель
+   template <class Owner, class TScratch>
+   TScratch& ThreadScratch() {
+      thread_local TScratch scratch;
+      return scratch;
+   }
+
+   // Аргументы и значения функций для вычислителей, считающих функции на своём типе чисел
+   template <class T>
+   struct ValueScratch {
+      std::vector<T> x;
+      std::vector<T> F;
+   };
+
+   // Рабочие векторы разностных схем
+   struct DifferenceScratch {
+      std::vector<double> x;
+      std::vector<double> f0;
+      std::vector<double> fp;
+      std::vector<double> fm;
+      std::vector<double> fp2;
+      std::vector<double> fm2;
+
+      // Точные сдвиги каждой переменной (со знаком), только для раскраски столбцов
+      std::vector<double> hp;
+      std::vector<double> hm;
+      std::vector<double> hp2;
+      std::vector<double> hm2;
+   };
+
+   /// <summary>
+   /// Численная матрица Якоби. Функции системы задаются так же, как для солвера: либо по одной
+   /// (double(size_t j, const std::vector&lt;double&gt;&amp; x)), либо все сразу (void(const double* x, double* F)).
+   /// Переменные сдвигаются по одной, и на каждый сдвиг все функции считаются один раз.
+   /// Рабочие векторы свои у каждого потока, поэтому один объект можно вызывать из нескольких потоков.
+   /// Объект сам подходит солверу в качестве функции дифференциалов.
+   /// </summary>
+   template <class TFunctions>
+   class FiniteDifferenceJacobian {
+   private:
+
+      TFunctions _functions;
+      size_t _varCount;
+      size_t _funcCount;
+
+      DifferenceScratch& _GetScratch() const {
+         DifferenceScratch& scratch = ThreadScratch<FiniteDifferenceJacobian, DifferenceScratch>();
+         scratch.x.resize(_varCount);
+         scratch.f0.resize(_funcCount);
+         scratch.fp.resize(_funcCount);
+         scratch.fm.resize(_funcCount);
+         if (scheme == DifferenceScheme::Richardson)
+         {
+            scratch.fp2.resize(_funcCount);
+            scratch.fm2.resize(_funcCount);
+         }
+         return scratch;
+      }
+
+      // Значения всех функций в точке x
+      void _Eval(const std::vector<double>& x, std::vector<double>& values) const {
+         EvaluateFunctions(_functions, _funcCount, x, values);
+      }
+
+      double _Step(const double* x, size_t var) const {
+         return DifferenceStep(scheme, relativeStep, typicalX, x, var);
+      }
+
+      // Записывает столбец var матрицы J: (fp - fm) / h
+      void _SetColumn(double* J, size_t var, const std::vector<double>& fp, const std::vector<double>& fm, double h) const {
+         for (size_t func = 0; func < _funcCount; func++)
+         {
+            J[func * _varCount + var] = (fp[func] - fm[func]) / h;
+         }
+      }
+
+   public:
+
+      DifferenceScheme scheme = DifferenceScheme::Forward;
+
+      // Относительный шаг, 0 - выбирается по схеме (sqrt, cbrt и корень 5 степени из машинного эпсилон)
+      double relativeStep = 0;
+
+      // Характерные величины переменных: шаг по x_i равен relativeStep * max(|x_i|, typicalX[i]).
+      // Если не задано, величины считаются равными 1
+      std::vector<double> typicalX;
+
+      /// <summary>
+      /// Инициализатор численной матрицы Якоби
+      /// </summary>
+      /// <param name="variableCount"> - количество переменных в системе</param>
+      /// <param name="funcCount"> - количество функций в системе</param>
+      /// <param name="functions"> - функции системы</param>
+      FiniteDifferenceJacobian(size_t variableCount, size_t funcCount, TFunctions functions)
+         : _functions(std::move(functions)), _varCount(variableCount), _funcCount(funcCount) {}
+
+      // Заполняет матрицу Якоби J (funcCount x variableCount, по строкам) в точке x
+      void operator()(const double* x, double* J) const {
+         operator()(x, nullptr, J);
+      }
+
+      // То же, но с уже известными значениями функций F в точке x (для правой разности
+      // это экономит одно вычисление функций). F может быть nullptr
+      void operator()(const double* x, const double* F, double* J) const {
+         DifferenceScratch& s = _GetScratch();
+         std::copy(x, x + _varCount, s.x.begin());
+
+         if (scheme == DifferenceScheme::Forward)
+         {
+            if (F)
+            {
+               std::copy(F, F + _funcCount, s.f0.begin());
+            }
+            else
+            {
+               _Eval(s.x, s.f0);
+            }
+         }
+
+         for (size_t var = 0; var < _varCount; var++)
+         {
+            double h = _Step(x, var);
+
+            // Берём шаг, который точно представим в double, чтобы не вносить лишнюю ошибку
+            s.x[var] = x[var] + h;
+            double hp = s.x[var] - x[var];
+            _Eval(s.x, s.fp);
+
+            if (scheme == DifferenceScheme::Forward)
+            {
+               _SetColumn(J, var, s.fp, s.f0, hp);
+            }
+            else
+            {
+               s.x[var] = x[var] - h;
+               double hm = x[var] - s.x[var];
+               _Eval(s.x, s.fm);
+
+               if (scheme == DifferenceScheme::Central)
+               {
+                  _SetColumn(J, var, s.fp, s.fm, hp + hm);
+               }
+               else
+               {
+                  // D(h/2) + (D(h/2) - D(h)) / 3 - убирает член порядка h^2
+                  s.x[var] = x[var] + h / 2;
+                  double hp2 = s.x[var] - x[var];
+                  _Eval(s.x, s.fp2);
+                  s.x[var] = x[var] - h / 2;
+                  double hm2 = x[var] - s.x[var];
+                  _Eval(s.x, s.fm2);
+
+                  for (size_t func = 0; func < _funcCount; func++)
+                  {
+                     double d1 = (s.fp[func] - s.fm[func]) / (hp + hm);
+                     double d2 = (s.fp2[func] - s.fm2[func]) / (hp2 + hm2);
+                     J[func * _varCount + var] = d2 + (d2 - d1) / 3;
+                  }
+               }
+            }
+
+            s.x[var] = x[var];
+         }
+      }
+   };
+
+
+   /// <summary>
+   /// Численная матрица Якоби для разреженных систем. По известной структуре матрицы столбцы
+   /// разбиваются на группы без общих строк (ColorColumns), и все переменные группы сдвигаются
+   /// одновременно: на матрицу уходит столько вычислений функций, сколько групп (для ленточных
+   /// матриц - ширина ленты), а не n. Результат пишется в плотную матрицу, в значения по
+   /// структуре (по строкам) или прямо в ProfileMatrix.
+   /// </summary>
+   template <class TFunctions>
+   class ColoredFiniteDifferenceJacobian {
+   private:
+
+      TFunctions _functions;
+      JacobianSparsity _sparsity;
+      ColumnColoring _coloring;
+
+      DifferenceScratch& _GetScratch() const {
+         DifferenceScratch& scratch = ThreadScratch<ColoredFiniteDifferenceJacobian, DifferenceScratch>();
+         size_t n = _sparsity.varCount;
+         size_t m = _sparsity.funcCount;
+         scratch.x.resize(n);
+         scratch.hp.resize(n);
+         scratch.hm.resize(n);
+         scratch.f0.resize(m);
+         scratch.fp.resize(m);
+         scratch.fm.resize(m);
+         if (scheme == DifferenceScheme::Richardson)
+         {
+            scratch.hp2.resize(n);
+            scratch.hm2.resize(n);
+            scratch.fp2.resize(m);
+            scratch.fm2.resize(m);
+         }
+         return scratch;
+      }
+
+      // Сдвигает все переменные группы color на coef * h, считает функции в values, пишет точные сдвиги в steps
+      void _Shift(DifferenceScratch& s, const double* x, size_t color, double coef, std::vector<double>& steps, std::vector<double>& values) const {
+         for (size_t k = _coloring.colorBegin[color]; k < _coloring.colorBegin[color + 1]; k++)
+         {
+            size_t var = _coloring.columns[k];
+            s.x[var] = x[var] + coef * DifferenceStep(scheme, relativeStep, typicalX, x, var);
+            steps[var] = s.x[var] - x[var];
+         }
+         EvaluateFunctions(_functions, _sparsity.funcCount, s.x, values);
+      }
+
+      // Профиль матрицы mat вмещает все ненулевые элементы структуры (строка i профиля
+      // занимает столбцы с i - (ia[i + 1] - ia[i]) по i - 1, верхний треугольник - симметрично)
+      bool _FitsProfile(const ProfileMatrix& mat) const {
+         size_t n = _sparsity.varCount;
+         if (mat.Size() != n || mat.ia.size() != n + 1)
+            return false;
+
+         for (size_t func = 0; func < _sparsity.funcCount; func++)
+         {
+            for (size_t k = _sparsity.rowBegin[func]; k < _sparsity.rowBegin[func + 1]; k++)
+            {
+               size_t row = std::max(func, _sparsity.cols[k]);
+               size_t col = std::min(func, _sparsity.cols[k]);
+               if (row - col > mat.ia[row + 1] - mat.ia[row])
+                  return false;
+            }
+         }
+         return true;
+      }
+
+      // Находит все ненулевые элементы, для каждого вызывает sink(pos, func, var, value),
+      // где pos - номер элемента в хранении по строкам
+      template <class Sink>
+      void _Evaluate(const double* x, const double* F, Sink&& sink) const {
+         DifferenceScratch& s = _GetScratch();
+         std::copy(x, x + _sparsity.varCount, s.x.begin());
+
+         if (scheme == DifferenceScheme::Forward)
+         {
+            if (F)
+            {
+               std::copy(F, F + _sparsity.funcCount, s.f0.begin());
+            }
+            else
+            {
+               EvaluateFunctions(_functions, _sparsity.funcCount, s.x, s.f0);
+            }
+         }
+
+         for (size_t color = 0; color < _coloring.colorCount; color++)
+         {
+            _Shift(s, x, color, 1.0, s.hp, s.fp);
+            if (scheme != DifferenceScheme::Forward)
+            {
+               _Shift(s, x, color, -1.0, s.hm, s.fm);
+            }
+            if (scheme == DifferenceScheme::Richardson)
+            {
+               _Shift(s, x, color, 0.5, s.hp2, s.fp2);
+               _Shift(s, x, color, -0.5, s.hm2, s.fm2);
+            }
+
+            // Строки разных столбцов группы не пересекаются, поэтому каждая строка
+            // разности относится ровно к одному столбцу
+            for (size_t k = _coloring.colorBegin[color]; k < _coloring.colorBegin[color + 1]; k++)
+            {
+               size_t var = _coloring.columns[k];
+               for (size_t p = _sparsity.colBegin[var]; p < _sparsity.colBegin[var + 1]; p++)
+               {
+                  size_t func = _sparsity.colRows[p];
+                  double value;
+                  switch (scheme)
+                  {
+                     case DifferenceScheme::Forward:
+                        value = (s.fp[func] - s.f0[func]) / s.hp[var];
+                        break;
+                     case DifferenceScheme::Central:
+                        value = (s.fp[func] - s.fm[func]) / (s.hp[var] - s.hm[var]);
+                        break;
+                     default:
+                     {
+                        double d1 = (s.fp[func] - s.fm[func]) / (s.hp[var] - s.hm[var]);
+                        double d2 = (s.fp2[func] - s.fm2[func]) / (s.hp2[var] - s.hm2[var]);
+                        value = d2 + (d2 - d1) / 3;
+                     }
+                  }
+                  sink(_sparsity.colPos[p], func, var, value);
+               }
+               s.x[var] = x[var];
+            }
+         }
+      }
+
+   public:
+
+      DifferenceScheme scheme = DifferenceScheme::Forward;
+
+      // Относительный шаг, 0 - выбирается по схеме (см. DifferenceStep)
+      double relativeStep = 0;
+
+      // Характерные величины переменных (см. DifferenceStep)
+      std::vector<double> typicalX;
+
+      /// <summary>
+      /// Инициализатор численной матрицы Якоби с известной структурой
+      /// </summary>
+      /// <param name="sparsity"> - структура ненулевых элементов матрицы Якоби</param>
+      /// <param name="functions"> - функции системы</param>
+      ColoredFiniteDifferenceJacobian(JacobianSparsity sparsity, TFunctions functions)
+         : _functions(std::move(functions)), _sparsity(std::move(sparsity))
+      {
+         _coloring = ColorColumns(_sparsity);
+      }
+
+      const JacobianSparsity& Sparsity() const {
+         return _sparsity;
+      }
+
+      // Число групп столбцов (вычислений функций на одну матрицу для правых разностей)
+      size_t ColorCount() const {
+         return _coloring.colorCount;
+      }
+
+      // Заполняет плотную матрицу Якоби J (funcCount x variableCount, по строкам) в точке x
+      void operator()(const double* x, double* J) const {
+         operator()(x, nullptr, J);
+      }
+
+      // То же, но с уже известными значениями функций F в точке x (F может быть nullptr)
+      void operator()(const double* x, const double* F, double* J) const {
+         size_t n = _sparsity.varCount;
+         std::fill(J, J + _sparsity.funcCount * n, 0.0);
+         _Evaluate(x, F, [&](size_t, size_t func, size_t var, double value) {
+            J[func * n + var] = value;
+         });
+      }
+
+      // Заполняет значения ненулевых элементов в порядке хранения структуры по строкам
+      void Evaluate(const double* x, const double* F, double* values) const {
+         _Evaluate(x, F, [&](size_t pos, size_t, size_t, double value) {
+            values[pos] = value;
+         });
+      }
+
+      // Заполняет квадратную матрицу Якоби в профильном формате. Профиль задаётся по структуре,
+      // если профиль матрицы не вмещает все ненулевые элементы (в том числе если не совпадает размер)
+      void Evaluate(const double* x, const double* F, ProfileMatrix& mat) const {
+         if (!_FitsProfile(mat))
+         {
+            _sparsity.MakeProfile(mat);
+         }
+         else
+         {
+            std::fill(mat.diag.begin(), mat.diag.end(), 0.0);
+            std::fill(mat.al.begin(), mat.al.end(), 0.0);
+            std::fill(mat.au.begin(), mat.au.end(), 0.0);
+            mat.type = ProfileMatrix::ProfileMatrixType::ProfileOnly;
+         }
+
+         _Evaluate(x, F, [&](size_t, size_t func, size_t var, double value) {
+            mat.Set(func, var, value);
+         });
+      }
+   };
+}
\ No newline at end of file
@@ -43,10 +43,26 @@ public:
       return al.size();
    }
 
+   // Reserve memory for matrix of size diagSize with up to aSize elements in each triangle,
+   // so that MakeFromMatrix does not reallocate while profile fits in it
+   void Reserve(std::size_t diagSize, std::size_t aSize) {
+      diag.reserve(diagSize);
+      ia.reserve(diagSize + 1);
+      al.reserve(aSize);
+      au.reserve(aSize);
+   }
+
    bool isEmpty() const { return type == ProfileMatrixType::Empty; }
    bool isLU() const { return type == ProfileMatrixType::LUdecomposed; }
 
    void MakeFromMatrix(const Matrix& mat);
 
+   // Make zero matrix with given profile: first[i] is the first column of row i
+   // (and the first row of column i) that is kept in the profile, first[i] <= i
+   void MakeProfile(const std::vector<std::size_t>& first);
+
+   // Set element (i, j), which should be inside the profile
+   void Set(std::size_t i, std::size_t j, double value);
+
    void LUdecompose();
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "../headers/ProfileMatrix.h"
+#include <algorithm>
 
 void ProfileMatrix::MakeFromMatrix(const Matrix& mat) {
    if (mat.Cols() != mat.Rows())
@@ -51,6 +52,45 @@ void ProfileMatrix::MakeFromMatrix(const Matrix& mat) {
    type = ProfileMatrixType::ProfileOnly;
 }
 
+void ProfileMatrix::MakeProfile(const std::vector<std::size_t>& first) {
+   std::size_t size = first.size();
+   diag.assign(size, 0);
+   ia.resize(size + 1);
+
+   std::size_t s = 0;
+   for (std::size_t i = 0; i < size; i++)
+   {
+      if (first[i] > i)
+         throw std::runtime_error("Bad profile (first column of row should not be after diagonal)");
+      ia[i] = s;
+      s += i - first[i];
+   }
+   ia[size] = s;
+
+   al.assign(s, 0);
+   au.assign(s, 0);
+
+   type = ProfileMatrixType::ProfileOnly;
+}
+
+void ProfileMatrix::Set(std::size_t i, std::size_t j, double value) {
+   if (i == j)
+   {
+      diag[i] = value;
+      return;
+   }
+
+   // Lower triangle is stored by rows, upper triangle - by columns
+   std::vector<double>& a = i > j ? al : au;
+   std::size_t row = std::max(i, j);
+   std::size_t col = std::min(i, j);
+   std::size_t first = row - (ia[row + 1] - ia[row]);
+   if (col < first)
+      throw std::runtime_error("Element is out of matrix profile");
+
+   a[ia[row] + col - first] = value;
+}
+
 void ProfileMatrix::LUdecompose() {
    for (size_t i = 0; i < Size(); i++)
    {
@@ -62,7 +102,9 @@ void ProfileMatrix::LUdecompose() {
       {
          size_t ki = ia[i];
          size_t kj = ia[j];
-         size_t dif = k - ia[i] - ia[j + 1] + ia[j];
+         // Difference between profile lengths of row i (before column j) and row j,
+         // it is signed, so it should not be computed in size_t
+         std::ptrdiff_t dif = std::ptrdiff_t(k - ia[i]) - std::ptrdiff_t(ia[j + 1] - ia[j]);
          if (dif < 0)
             kj -= dif;
          else
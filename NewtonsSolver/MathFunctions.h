@@ -0,0 +1,9 @@
+#pragma once
+#include <cmath>
+
+namespace Newtons {
+
+   // Перегрузки для Dual и AVar иначе скрыли бы стандартные функции для double в коде внутри Newtons
+   using std::sqrt, std::exp, std::log, std::sin, std::cos, std::tan, std::asin, std::acos, std::atan,
+      std::sinh, std::cosh, std::tanh, std::abs, std::fabs, std::pow, std::atan2;
+}
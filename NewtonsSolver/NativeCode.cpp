@@ -0,0 +1,300 @@
+#include "NativeCode.h"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+namespace Newtons {
+
+   namespace {
+
+      // Число в виде литерала C++, который читается обратно без потерь
+      std::string _Literal(double value) {
+         if (std::isnan(value))
+            return "std::numeric_limits<double>::quiet_NaN()";
+         if (std::isinf(value))
+            return value > 0 ? "std::numeric_limits<double>::infinity()" : "-std::numeric_limits<double>::infinity()";
+
+         // to_chars не зависит от локали (в отличие от "%a") и пишет шестнадцатеричную запись без префикса 0x
+         char buffer[64];
+         char* end = std::to_chars(buffer, buffer + sizeof(buffer), std::abs(value), std::chars_format::hex).ptr;
+         return std::string(std::signbit(value) ? "(-0x" : "(0x") + std::string(buffer, end) + ")";
+      }
+
+      // Выражение узла через имена его аргументов
+      std::string _Expression(const ExprNode& node) {
+         std::string a = "t" + std::to_string(node.a);
+         std::string b = "t" + std::to_string(node.b);
+         switch (node.op)
+         {
+         case ExprOp::Const: return _Literal(node.value);
+         case ExprOp::Var: return "x[" + std::to_string(node.a) + "]";
+         case ExprOp::Add: return a + " + " + b;
+         case ExprOp::Sub: return a + " - " + b;
+         case ExprOp::Mul: return a + " * " + b;
+         case ExprOp::Div: return a + " / " + b;
+         case ExprOp::Pow: return "std::pow(" + a + ", " + b + ")";
+         case ExprOp::Atan2: return "std::atan2(" + a + ", " + b + ")";
+         case ExprOp::Neg: return "-" + a;
+         case ExprOp::Sqrt: return "std::sqrt(" + a + ")";
+         case ExprOp::Exp: return "std::exp(" + a + ")";
+         case ExprOp::Log: return "std::log(" + a + ")";
+         case ExprOp::Sin: return "std::sin(" + a + ")";
+         case ExprOp::Cos: return "std::cos(" + a + ")";
+         case ExprOp::Tan: return "std::tan(" + a + ")";
+         case ExprOp::Asin: return "std::asin(" + a + ")";
+         case ExprOp::Acos: return "std::acos(" + a + ")";
+         case ExprOp::Atan: return "std::atan(" + a + ")";
+         case ExprOp::Sinh: return "std::sinh(" + a + ")";
+         case ExprOp::Cosh: return "std::cosh(" + a + ")";
+         case ExprOp::Tanh: return "std::tanh(" + a + ")";
+         case ExprOp::Abs: return "std::abs(" + a + ")";
+         }
+         return "0";
+      }
+
+      // Тело функции: узлы, нужные для outputs, по одному на строку, затем запись выходов.
+      // Каждый узел - отдельная константа, распределение регистров остаётся компилятору
+      void _EmitBody(std::ostringstream& out, const ExprGraph& graph, const std::vector<std::uint32_t>& outputs,
+         const std::string& F, size_t funcCount, const std::string& J)
+      {
+         std::vector<bool> used(graph.nodes.size());
+         for (std::uint32_t node : outputs)
+         {
+            used[node] = true;
+         }
+         for (size_t i = graph.nodes.size(); i-- > 0; )
+         {
+            const ExprNode& node = graph.nodes[i];
+            if (!used[i] || node.op == ExprOp::Const || node.op == ExprOp::Var)
+               continue;
+
+            used[node.a] = true;
+            if (node.op < ExprOp::Neg)
+            {
+               used[node.b] = true;
+            }
+         }
+
+         for (size_t i = 0; i < graph.nodes.size(); i++)
+         {
+            if (used[i])
+            {
+               out << "   const double t" << i << " = " << _Expression(graph.nodes[i]) << ";\n";
+            }
+         }
+         for (size_t k = 0; k < outputs.size(); k++)
+         {
+            if (k < funcCount)
+               out << "   " << F << "[" << k << "] = t" << outputs[k] << ";\n";
+            else
+               out << "   " << J << "[" << k - funcCount << "] = t" << outputs[k] << ";\n";
+         }
+      }
+
+      // FNV-1a, 64 бита
+      std::uint64_t _Hash(const std::string& text) {
+         std::uint64_t h = 14695981039346656037ull;
+         for (unsigned char c : text)
+         {
+            h ^= c;
+            h *= 1099511628211ull;
+         }
+         return h;
+      }
+
+      // Суффикс имени временных файлов, свой у каждого процесса и каждого вызова
+      std::string _UniqueSuffix() {
+#if defined(_WIN32)
+         unsigned long pid = GetCurrentProcessId();
+#else
+         unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+         std::random_device random;
+         char buffer[48];
+         std::snprintf(buffer, sizeof(buffer), "%lu.%08x%08x", pid, random(), random());
+         return buffer;
+      }
+
+      // Пути в папке кэша подставляются в команду компиляции в кавычках. Символы, которые
+      // внутри кавычек всё равно разбирает командная оболочка, в пути к папке не допускаются
+      void _CheckCommandPath(const std::string& path) {
+#if defined(_WIN32)
+         const char* special = "\"%\r\n";
+#else
+         const char* special = "\"$`\\\r\n";
+#endif
+         if (path.find_first_of(special) != std::string::npos)
+            throw std::runtime_error("Cache path '" + path + "' contains characters that cannot be passed to the compile command.");
+      }
+
+      void _Replace(std::string& text, const std::string& what, const std::string& with) {
+         for (size_t pos = text.find(what); pos != std::string::npos; pos = text.find(what, pos + with.size()))
+         {
+            text.replace(pos, what.size(), with);
+         }
+      }
+   }
+
+   std::string EmitCpp(const SymbolicJacobian& symbolic) {
+      const ExprGraph& graph = symbolic.Graph();
+      const std::vector<std::uint32_t>& equations = symbolic.Equations();
+      std::vector<std::uint32_t> outputs(equations);
+      outputs.insert(outputs.end(), symbolic.Entries().begin(), symbolic.Entries().end());
+
+      std::ostringstream out;
+      out << "// Generated by Newtons::EmitCpp\n"
+         << "#include <cmath>\n"
+         << "#include <limits>\n\n"
+         << "#if defined(_WIN32)\n"
+         << "#define NEWTONS_EXPORT extern \"C\" __declspec(dllexport)\n"
+         << "#else\n"
+         << "#define NEWTONS_EXPORT extern \"C\"\n"
+         << "#endif\n\n";
+
+      out << "NEWTONS_EXPORT void newtons_residual(const double* x, double* F) {\n";
+      _EmitBody(out, graph, equations, "F", equations.size(), "");
+      out << "}\n\n";
+
+      out << "NEWTONS_EXPORT void newtons_fused(const double* x, double* F, double* J) {\n";
+      _EmitBody(out, graph, outputs, "F", equations.size(), "J");
+      out << "}\n";
+
+      return out.str();
+   }
+
+   struct NativeJacobian::_Library {
+#if defined(_WIN32)
+      HMODULE handle = nullptr;
+
+      explicit _Library(const std::string& path) : handle(LoadLibraryA(path.c_str())) {}
+      ~_Library() { if (handle) FreeLibrary(handle); }
+
+      void* Symbol(const char* name) const {
+         return reinterpret_cast<void*>(GetProcAddress(handle, name));
+      }
+#else
+      void* handle = nullptr;
+
+      explicit _Library(const std::string& path) : handle(dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL)) {}
+      ~_Library() { if (handle) dlclose(handle); }
+
+      void* Symbol(const char* name) const {
+         return dlsym(handle, name);
+      }
+#endif
+   };
+
+   NativeJacobian::NativeJacobian(const SymbolicJacobian& symbolic, const NativeOptions& options)
+      : _sparsity(symbolic.Sparsity())
+   {
+      namespace fs = std::filesystem;
+
+      std::string source = EmitCpp(symbolic);
+
+      // Имя файла по исходнику и команде компиляции: другой компилятор или флаги - другая библиотека
+      char name[32];
+      std::snprintf(name, sizeof(name), "newtons_%016llx", static_cast<unsigned long long>(_Hash(source + '\n' + options.compileCommand)));
+#if defined(_WIN32)
+      const char* extension = ".dll";
+#else
+      const char* extension = ".so";
+#endif
+      fs::path dir(options.cacheDir);
+      fs::path library = dir / (std::string(name) + extension);
+      _path = library.string();
+
+      // Готовая библиотека появляется в кэше только переименованием целиком записанного файла,
+      // но кэш мог испортиться и снаружи - тогда она компилируется заново
+      if (!fs::exists(library) || !_Load())
+      {
+         _CheckCommandPath(dir.string());
+         fs::create_directories(dir);
+
+         // У каждого процесса свои исходник и временная библиотека, иначе одновременные
+         // компиляции одной системы пишут в один и тот же файл
+         std::string unique = std::string(name) + "." + _UniqueSuffix();
+         fs::path sourcePath = dir / (unique + ".cpp");
+         fs::path temp = dir / (unique + ".tmp" + extension);
+         {
+            std::ofstream file(sourcePath);
+            file << source;
+            if (!file)
+               throw std::runtime_error("Cannot write generated source '" + sourcePath.string() + "'.");
+         }
+
+         std::string command = options.compileCommand;
+         _Replace(command, "{source}", sourcePath.string());
+         _Replace(command, "{output}", temp.string());
+         bool built = std::system(command.c_str()) == 0 && fs::exists(temp);
+         std::error_code error;
+         fs::remove(sourcePath, error);
+         if (!built)
+         {
+            fs::remove(temp, error);
+            throw std::runtime_error("Compilation of generated source failed: " + command);
+         }
+
+         // Переименование атомарно. Если другой процесс успел положить ту же библиотеку
+         // (а в Windows её нельзя заменить, пока она загружена), берём его
+         fs::rename(temp, library, error);
+         if (error)
+         {
+            fs::remove(temp, error);
+         }
+         _compiled = true;
+
+         if (!_Load())
+            throw std::runtime_error("Cannot load compiled library '" + _path + "'.");
+      }
+   }
+
+   bool NativeJacobian::_Load() {
+      _library = std::make_shared<_Library>(_path);
+      if (!_library->handle)
+         return false;
+
+      _residual = reinterpret_cast<_Residual>(_library->Symbol("newtons_residual"));
+      _fused = reinterpret_cast<_Fused>(_library->Symbol("newtons_fused"));
+      if (!_residual || !_fused)
+      {
+         _library.reset();
+         return false;
+      }
+      return true;
+   }
+
+   void NativeJacobian::operator()(const double* x, double* F, double* J) const {
+      if (!J)
+      {
+         _residual(x, F);
+         return;
+      }
+
+      thread_local std::vector<double> values;
+      values.resize(_sparsity.NonZeros());
+      _fused(x, F, values.data());
+
+      std::fill(J, J + _sparsity.funcCount * _sparsity.varCount, 0.0);
+      for (size_t func = 0; func < _sparsity.funcCount; func++)
+      {
+         for (size_t k = _sparsity.rowBegin[func]; k < _sparsity.rowBegin[func + 1]; k++)
+         {
+            J[func * _sparsity.varCount + _sparsity.cols[k]] = values[k];
+         }
+      }
+   }
+}
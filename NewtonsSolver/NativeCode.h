@@ -0,0 +1,85 @@
+#pragma once
+#include "Symbolic.h"
+#include <memory>
+#include <string>
+
+namespace Newtons {
+
+   // Настройки компиляции функций системы в машинный код
+   struct NativeOptions {
+      // Папка для исходников и скомпилированных библиотек. Библиотека называется по хэшу
+      // исходника и команды компиляции, поэтому одна и та же система компилируется один раз.
+      // Папку могут одновременно использовать несколько процессов: каждый компилирует в свой
+      // временный файл, а в кэш библиотека попадает атомарным переименованием
+      std::string cacheDir = "newtons_cache";
+
+      // Команда компиляции, {source} и {output} заменяются путями к исходнику и библиотеке
+#if defined(_WIN32)
+      std::string compileCommand = "cl /nologo /O2 /LD \"{source}\" /Fe\"{output}\" > nul";
+#else
+      std::string compileCommand = "c++ -O2 -shared -fPIC -o \"{output}\" \"{source}\"";
+#endif
+   };
+
+   // Исходник на C++ с функциями
+   //   extern "C" void newtons_residual(const double* x, double* F)
+   //   extern "C" void newtons_fused(const double* x, double* F, double* J)
+   // где J - ненулевые элементы матрицы Якоби в порядке хранения по строкам symbolic.Sparsity()
+   std::string EmitCpp(const SymbolicJacobian& symbolic);
+
+   /// <summary>
+   /// Функции системы и матрица Якоби, скомпилированные в машинный код. Исходник строится
+   /// по символьной матрице Якоби (общие подвыражения уже объединены), компилируется системным
+   /// компилятором в динамическую библиотеку и загружается (dlopen / LoadLibrary). Готовые
+   /// библиотеки берутся из папки кэша без компиляции.
+   /// Объект считает и функции, и матрицу Якоби (void(const double* x, double* F, double* J)),
+   /// поэтому его можно передать солверу одной функцией.
+   /// </summary>
+   class NativeJacobian {
+   private:
+
+      using _Residual = void (*)(const double*, double*);
+      using _Fused = void (*)(const double*, double*, double*);
+
+      struct _Library;
+
+      // Библиотека выгружается, когда удалена последняя копия объекта
+      std::shared_ptr<_Library> _library;
+      _Residual _residual = nullptr;
+      _Fused _fused = nullptr;
+
+      JacobianSparsity _sparsity;
+      std::string _path;
+      bool _compiled = false;
+
+      // Загружает библиотеку _path, возвращает false, если её нет или в ней нет функций системы
+      bool _Load();
+
+   public:
+
+      /// <summary>
+      /// Компилирует (или берёт из кэша) и загружает функции системы, при ошибке бросает std::runtime_error
+      /// </summary>
+      /// <param name="symbolic"> - символьная матрица Якоби системы</param>
+      /// <param name="options"> - настройки компиляции</param>
+      explicit NativeJacobian(const SymbolicJacobian& symbolic, const NativeOptions& options = {});
+
+      const JacobianSparsity& Sparsity() const {
+         return _sparsity;
+      }
+
+      // Путь к загруженной библиотеке
+      const std::string& Path() const {
+         return _path;
+      }
+
+      // Библиотека была скомпилирована при создании объекта (false - взята из кэша)
+      bool Compiled() const {
+         return _compiled;
+      }
+
+      // Значения функций F и матрица Якоби J (funcCount x variableCount, по строкам) в точке x,
+      // J может быть nullptr
+      void operator()(const double* x, double* F, double* J) const;
+   };
+}
@@ -1,94 +1,274 @@
 #pragma once
 #include "LU solver/headers/ProfileLU.h"
+#include "Vec.h"
+#include "FiniteDifferences.h"
+#include "Dual.h"
+#include "QR.h"
 #include <cmath>
+#include <concepts>
 #include <functional>
 #include <algorithm>
 #include <iostream>
+#include <type_traits>
 #include <format>
 
 namespace Newtons {
 
-   
-   namespace Vec {
-      inline double Scalar(const std::vector<double>& l, const std::vector<double>& r);
+   struct TraceElement {
+      int iterationNum{};
+      std::vector<double> prevX;
+      std::vector<double> X;
+      std::vector<double> dX;
+      double eps{};
+      double prevEps{};
 
-      inline double Norm(const std::vector<double>& vec);
+      TraceElement() noexcept {}
 
-      // ans = left + coef * right
-      inline void AddVec(
-         const std::vector<double>& left,
-         double coef,
-         const std::vector<double>& right,
-         std::vector<double>& ans) 
-      {
-         for (size_t i = 0; i < right.size(); i++)
-         {
-            ans[i] = left[i] + coef * right[i];
-         }
+      TraceElement(const TraceElement& elem) noexcept {
+         iterationNum = elem.iterationNum;
+         prevX = (elem.prevX);
+         X = (elem.X);
+         dX = (elem.dX);
+         eps = elem.eps;
+         prevEps = elem.prevEps;
       }
-   }
 
+      TraceElement(TraceElement&& elem) noexcept {
+         iterationNum = elem.iterationNum;
+         prevX = std::move(elem.prevX);
+         X = std::move(elem.X);
+         dX = std::move(elem.dX);
+         eps = elem.eps;
+         prevEps = elem.prevEps;
+      }
+
+      // Копирование в уже существующий элемент переиспользует память его векторов
+      TraceElement& operator=(const TraceElement& elem) noexcept {
+         iterationNum = elem.iterationNum;
+         prevX = elem.prevX;
+         X = elem.X;
+         dX = elem.dX;
+         eps = elem.eps;
+         prevEps = elem.prevEps;
+         return *this;
+      }
+
+      TraceElement& operator=(TraceElement&& elem) noexcept {
+         iterationNum = elem.iterationNum;
+         prevX = std::move(elem.prevX);
+         X = std::move(elem.X);
+         dX = std::move(elem.dX);
+         eps = elem.eps;
+         prevEps = elem.prevEps;
+         return *this;
+      }
+   };
+
+   // Трассировка хранит элементы между запусками: Clear() только сбрасывает размер,
+   // а новые шаги записываются в уже выделенные элементы
+   class TraceVector {
+   private:
+      std::vector<TraceElement> _traceVec;
+      size_t _size = 0;
 
-   class NewtonsSolver {
    public:
+      TraceElement& operator[](size_t ind) {
+         return _traceVec[ind];
+      }
 
-      struct TraceElement {
-         int iterationNum{};
-         std::vector<double> prevX;
-         std::vector<double> X;
-         std::vector<double> dX;
-         double eps{};
-         double prevEps{};
-
-         TraceElement() noexcept {}
-
-         TraceElement(const TraceElement& elem) noexcept {
-            iterationNum = elem.iterationNum;
-            prevX = (elem.prevX);
-            X = (elem.X);
-            dX = (elem.dX);
-            eps = elem.eps;
-            prevEps = elem.prevEps;
-         }
-
-         TraceElement(TraceElement&& elem) noexcept {
-            iterationNum = elem.iterationNum;
-            prevX = std::move(elem.prevX);
-            X = std::move(elem.X);
-            dX = std::move(elem.dX);
-            eps = elem.eps;
-            prevEps = elem.prevEps;
+      // Возвращает следующий свободный элемент трассировки
+      TraceElement& Next() {
+         if (_size == _traceVec.size())
+         {
+            _traceVec.emplace_back();
          }
-      };
+         return _traceVec[_size++];
+      }
+
+      void Push(TraceElement&& elem) {
+         Next() = std::move(elem);
+      }
+      void Push(TraceElement& elem) {
+         Next() = elem;
+      }
 
-      class TraceVector {
-      private:
-         std::vector<TraceElement> _traceVec;
+      void Clear() {
+         _size = 0;
+      }
+
+      size_t Size() const {
+         return _size;
+      }
 
-      public:
-         TraceElement& operator[](size_t ind) {
-            return _traceVec[ind];
+      void Resize(size_t newSize) {
+         if (newSize > _traceVec.size())
+         {
+            _traceVec.resize(newSize);
          }
+         _size = newSize;
+      }
 
-         void Push(TraceElement&& elem) {
-            _traceVec.push_back(elem);
+      // Заранее выделяет память под count шагов метода с varCount переменными
+      // Возвращает число буферов, под которые пришлось выделить память
+      size_t Reserve(size_t count, size_t varCount) {
+         size_t allocations = 0;
+         if (_traceVec.capacity() < count)
+         {
+            _traceVec.reserve(count);
+            allocations++;
          }
-         void Push(TraceElement& elem) {
-            _traceVec.push_back(elem);
+         if (_traceVec.size() < count)
+         {
+            _traceVec.resize(count);
          }
-
-         void Clear() {
-            _traceVec.clear();
+         for (auto& elem : _traceVec)
+         {
+            for (auto* vec : { &elem.prevX, &elem.X, &elem.dX })
+            {
+               if (vec->capacity() < varCount)
+               {
+                  vec->reserve(varCount);
+                  allocations++;
+               }
+            }
          }
+         return allocations;
+      }
+   };
 
-         size_t Size() const {
-            return _traceVec.size();
-         }
+   // Тип автоматического масштабирования (эквилибрации) системы
+   // - None - без масштабирования
+   // - MaxNorm - деление строк, затем столбцов матрицы Якоби на их максимальный по модулю элемент
+   // - Ruiz - итерационное масштабирование Ruiz'а (деление на корень из максимума строки и столбца)
+   // Множители обновляются на каждой итерации и округляются до степени двойки, поэтому
+   // меняются только при заметном изменении матрицы Якоби. Невязка eps при этом считается
+   // по масштабированным функциям.
+   enum class ScalingType {
+      None,
+      MaxNorm,
+      Ruiz
+   };
 
-         void Resize(size_t newSize) {
-            return _traceVec.resize(newSize);
-         }
-      };
+   // Способ получения матрицы Якоби на итерациях метода
+   // - Newton - матрица считается и раскладывается заново на каждой итерации
+   // - Chord - разложение матрицы используется на нескольких итерациях подряд (метод хорд,
+   //   с refreshInterval - метод Шаманского), итерация стоит одного решения СЛАУ с готовым LU
+   // - Broyden - матрица считается один раз, дальше к её LU-разложению добавляются обновления
+   //   Бройдена ранга 1 (по формуле Шермана-Моррисона), итерация стоит O(1) вычислений функций.
+   //   Матрица считается заново, когда метод перестаёт сходиться (см. refreshRatio)
+   enum class JacobianUpdate {
+      Newton,
+      Chord,
+      Broyden
+   };
+
+   // Шаг для неквадратных систем (число функций не равно числу переменных)
+   // - Mask - лишние функции (с наименьшими |F_j|) или переменные (с наименьшими производными)
+   //   отбрасываются, и решается квадратная система
+   // - LeastSquares - шаг Гаусса-Ньютона по всем функциям и переменным через QR-разложение
+   //   матрицы Якоби: для переопределённых систем - решение min ||J dx + F||, для недоопределённых -
+   //   решение J dx = -F наименьшей длины. Используется с Halving и Armijo, остальные StepControl
+   //   строят шаг сами
+   enum class NonSquare {
+      Mask,
+      LeastSquares
+   };
+
+   // Порядок шага метода
+   // - Newton - шаг Ньютона J a = -F
+   // - Chebyshev - шаг Чебышёва a + c, J c = -F''(x)[a, a] / 2 (кубическая сходимость).
+   //   Вторая производная по направлению a считается центральной разностью (2 вычисления функций),
+   //   поправка решается тем же LU-разложением. Используется с Halving и Armijo для квадратных систем
+   //   (и систем с маской)
+   enum class StepOrder {
+      Newton,
+      Chebyshev
+   };
+
+   // Способ выбора длины шага coef вдоль направления метода
+   // - Halving - coef делится на 2, пока невязка не уменьшится
+   // - Armijo - шаг принимается при достаточном уменьшении невязки ||F(x + coef dx)|| <= (1 - armijo * coef) ||F(x)||,
+   //   иначе новый coef - минимум квадратичной (затем кубической) модели ||F||^2 по уже посчитанным невязкам
+   // - Dogleg - доверительная область (Пауэлл): шаг - ломаная от точки Коши к шагу Ньютона,
+   //   обрезанная радиусом области; радиус меняется по отношению реального и предсказанного
+   //   моделью уменьшения ||F||^2. Вырожденная матрица не останавливает метод - шаг идёт по градиенту
+   // - Steihaug - та же доверительная область, шаг - метод сопряжённых градиентов для ||B p - F||^2
+   //   (Стейхауг-Тойнт), обрывающийся на границе области. Матрица не раскладывается (для больших систем)
+   // - LevenbergMarquardt - шаг Гаусса-Ньютона с затуханием: (J^T J + lambda diag(J^T J)) dx = -J^T F
+   //   по всем функциям и переменным (без маски), lambda подстраивается по отношению реального и
+   //   предсказанного уменьшения ||F||^2. Матрица системы невырождена при любой матрице Якоби
+   // - PseudoTransient - псевдонестационарное продолжение: (J + I / dt) dx = -F и полный шаг, то есть
+   //   неявный шаг по времени для dx/dt = -F. dt растёт по мере уменьшения невязки (dt *= ||F_prev|| / ||F||),
+   //   и метод переходит в метод Ньютона. Невязка на промежуточных шагах может расти, но не больше чем
+   //   в pseudoMaxGrowth раз от наименьшей и не дольше pseudoStallSteps шагов подряд
+   enum class StepControl {
+      Halving,
+      Armijo,
+      Dogleg,
+      Steihaug,
+      LevenbergMarquardt,
+      PseudoTransient
+   };
+
+
+   // Функция, считающая сразу все функции системы: void(const double* x, double* F)
+   template <class T>
+   concept VectorResidual = std::invocable<T&, const double*, double*>;
+
+
+   // Солвер получает функции и их дифференциалы как параметры шаблона: для лямбд и функторов
+   // компилятор может встроить их вызовы прямо в циклы сборки матрицы Якоби и подсчёта невязки.
+   // NewtonsSolver (ниже) - тот же солвер с функциями в std::function
+   // Вся матрица Якоби (funcCount x variableCount, по строкам): void(const double* x, double* J)
+   template <class T>
+   concept DenseJacobian = std::invocable<T&, const double*, double*>;
+
+   // Приёмник ненулевых элементов матрицы Якоби в виде троек (функция, переменная, значение).
+   // Повторяющиеся элементы складываются
+   class JacobianTriplets {
+   private:
+      double* _jac;
+      size_t _varCount;
+
+   public:
+      JacobianTriplets(double* jac, size_t varCount) : _jac(jac), _varCount(varCount) {}
+
+      void Add(size_t func, size_t var, double value) {
+         _jac[func * _varCount + var] += value;
+      }
+   };
+
+   // Ненулевые элементы матрицы Якоби тройками: void(const double* x, JacobianTriplets& J)
+   template <class T>
+   concept TripletJacobian = std::invocable<T&, const double*, JacobianTriplets&>;
+
+   // Вся матрица Якоби по уже известным значениям функций в x: void(const double* x, const double* F, double* J)
+   // (например, FiniteDifferenceJacobian)
+   template <class T>
+   concept DenseJacobianFromResidual = std::invocable<T&, const double*, const double*, double*>;
+
+   // Функции и матрица Якоби за один вызов: void(const double* x, double* F, double* J),
+   // при J == nullptr считаются только функции
+   template <class T>
+   concept FusedResidualJacobian = std::invocable<T&, const double*, double*, double*> && !DenseJacobianFromResidual<T>;
+
+   // Функции и матрица Якоби заданы одним и тем же объектом: солвер хранит его один раз, чтобы не держать
+   // две копии (и два состояния) у объектов с лентой, графом или загруженной библиотекой
+   template <class TFunctions, class TDifferentials>
+   concept SingleResidualJacobian = FusedResidualJacobian<TFunctions> && std::same_as<TFunctions, TDifferentials>;
+
+
+   template <class TFunctions, class TDifferentials = TFunctions>
+   class BasicNewtonsSolver {
+   public:
+
+      using TraceElement = Newtons::TraceElement;
+      using TraceVector = Newtons::TraceVector;
+      using ScalingType = Newtons::ScalingType;
+      using JacobianUpdate = Newtons::JacobianUpdate;
+      using StepControl = Newtons::StepControl;
+      using NonSquare = Newtons::NonSquare;
+      using StepOrder = Newtons::StepOrder;
 
    private:
 
@@ -100,9 +280,13 @@ namespace Newtons {
       std::vector<double> _dx;
       std::vector<double> _dx_trim;
 
+      // Функции и матрица Якоби одним объектом хранятся только в _functions
+      static constexpr bool _single = SingleResidualJacobian<TFunctions, TDifferentials>;
+      struct _SameAsFunctions {};
+
       // Переменные для хранения фунцкий и их дифференциалов
-      std::function<double(std::size_t, const std::vector<double>&)> _functions;
-      std::function<double(std::size_t, const std::size_t, std::vector<double>&)> _differentials;
+      TFunctions _functions;
+      std::conditional_t<_single, _SameAsFunctions, TDifferentials> _differentials;
 
       // Переменные для хранения количества функций и переменных
       size_t _funcCount;
@@ -122,8 +306,100 @@ namespace Newtons {
       // Маска для исключения лишних переменных или функций
       std::vector<bool> _mask;
 
+      // Полная матрица Якоби в точке _x (funcCount x varCount, по строкам), считается один раз
+      // за итерацию и используется и для выбора маски, и для сборки _mat
+      std::vector<double> _jac;
+
+      // Номера функций и переменных, соответствующие строкам и столбцам _mat
+      std::vector<size_t> _funcMap;
+      std::vector<size_t> _varMap;
+
+      // Значения функций F в текущей точке _x и в пробной точке шага (без масштабирования)
+      std::vector<double> _Fx;
+      std::vector<double> _Ftrial;
+
+      // Обновления Бройдена B_{i+1} = B_i + a_i s_i^T: s_i - шаги, z_i = B_i^{-1} a_i,
+      // den_i = 1 + (s_i, z_i) (всё - в масштабированных переменных _mat)
+      std::vector<std::vector<double>> _broydenA;
+      std::vector<std::vector<double>> _broydenS;
+      std::vector<std::vector<double>> _broydenZ;
+      std::vector<double> _broydenDen;
+      size_t _broydenCount = 0;
+
+      // Рабочий вектор размера _mat
+      std::vector<double> _work;
+
+      // В _profMat лежит разложение самой матрицы Якоби (без сдвига диагонали), см. SolveLastJacobian
+      bool _jacobianFactored = false;
+
+      // Доверительная область (в масштабированных переменных _mat): радиус, направление
+      // наискорейшего спуска модели B^T F, точка Коши (направление в методе сопряжённых градиентов),
+      // шаг, его образ B p и невязка метода сопряжённых градиентов
+      double _radius = 0;
+      std::vector<double> _grad;
+      std::vector<double> _cauchy;
+      std::vector<double> _step;
+      std::vector<double> _model;
+      std::vector<double> _cgResidual;
+
+      // Текущий псевдовременной шаг StepControl::PseudoTransient, наименьшая невязка за запуск Solve
+      // (без масштабирования: множители меняются при каждом пересчёте матрицы) и число принятых шагов
+      // подряд, которые её не уменьшили
+      double _timeStep = 0;
+      double _pseudoBest = 0;
+      size_t _pseudoStall = 0;
+
+      // QR-разложение матрицы Якоби (переопределённые системы) или транспонированной матрицы
+      // (недоопределённые) для NonSquare::LeastSquares и правая часть размера max(m, n)
+      HouseholderQR _qr;
+      std::vector<double> _qrRhs;
+
+      // Шаг Чебышёва: точка x +- h a, функции в ней и поправка c в масштабированных переменных _mat
+      std::vector<double> _secondX;
+      std::vector<double> _secondPlus;
+      std::vector<double> _secondMinus;
+      std::vector<double> _secondStep;
+
+      // Ускорение Андерсона: разности последних точек и шагов (кольцевой буфер), предыдущие точка и шаг,
+      // текущий шаг (он же правая часть задачи наименьших квадратов), смешанная точка и функции в ней
+      std::vector<std::vector<double>> _andersonDX;
+      std::vector<std::vector<double>> _andersonDF;
+      std::vector<double> _andersonPrevX;
+      std::vector<double> _andersonPrevF;
+      std::vector<double> _andersonStep;
+      std::vector<double> _andersonMixed;
+      std::vector<double> _andersonF;
+      HouseholderQR _andersonQR;
+      size_t _andersonStored = 0;
+      size_t _andersonNext = 0;
+      bool _andersonHasPrev = false;
+
+      // Метод Левенберга-Марквардта: матрица J^T J, её диагональ (масштаб затухания), -J^T F,
+      // текущий параметр затухания и множитель его роста после неудачного шага
+      Matrix _normal;
+      std::vector<double> _normalDiag;
+      std::vector<double> _gradFull;
+      double _damping = 0;
+      double _dampingGrowth = 2;
+
+      // Масштабные множители функций (строк) и переменных (столбцов) матрицы Якоби
+      std::vector<double> _rowScale;
+      std::vector<double> _colScale;
+      std::vector<double> _rowScaleTrim;
+      std::vector<double> _colScaleTrim;
+
+      // Структура матрицы Якоби: задана через SetSparsity или найдена при первом запуске Solve
+      JacobianSparsity _sparsity;
+      bool _hasSparsity = false;
+
+      // Память под профиль _profMat выделяется при первом запуске Solve, когда структура уже известна
+      bool _profileReserved = false;
+
       // Указатель на массив для трассировки метода (получение результата вычислений на каждом шагу)
-      TraceVector* _traceVector;
+      TraceVector* _traceVector = nullptr;
+
+      // Число выделений памяти под рабочие буферы солвера (см. AllocationCount)
+      size_t _allocations = 0;
 
    public:
 
@@ -132,61 +408,314 @@ namespace Newtons {
       /// </summary>
       /// <param name="variableCount"> - количество переменных в системе</param>
       /// <param name="funcCount"> - количество функций в системе</param>
-      /// <param name="functions"> - функция, в которой заданы все функции F_j системы</param>
-      /// <param name="differentials"> - функция, в которой заданы все дифференциалы системы. </param>
-      NewtonsSolver(
+      /// <param name="functions"> - функция, в которой заданы все функции F_j системы: либо по одной
+      /// (double(size_t j, const std::vector&lt;double&gt;&amp; x)), либо все сразу (void(const double* x, double* F))</param>
+      /// <param name="differentials"> - функция, в которой заданы все дифференциалы системы: либо по одному
+      /// (double(size_t j, size_t i, const std::vector&lt;double&gt;&amp; x)), либо вся матрица Якоби сразу -
+      /// плотная (void(const double* x, double* J), J - матрица funcCount x variableCount по строкам)
+      /// или тройками (void(const double* x, JacobianTriplets&amp; J))</param>
+      BasicNewtonsSolver(
+         size_t variableCount,
+         size_t funcCount,
+         TFunctions functions,
+         TDifferentials differentials)
+         requires (!SingleResidualJacobian<TFunctions, TDifferentials>)
+         : _functions(std::move(functions)), _differentials(std::move(differentials))
+      {
+         _Init(variableCount, funcCount);
+      }
+
+      /// <summary>
+      /// Инициализатор солвера методом Ньютона с одной функцией, считающей и функции, и матрицу Якоби
+      /// </summary>
+      /// <param name="variableCount"> - количество переменных в системе</param>
+      /// <param name="funcCount"> - количество функций в системе</param>
+      /// <param name="functions"> - функция void(const double* x, double* F, double* J), J может быть nullptr,
+      /// если нужны только значения функций</param>
+      BasicNewtonsSolver(
          size_t variableCount,
          size_t funcCount,
-         std::function<double(size_t, const std::vector<double>&)> functions,
-         std::function<double(size_t, size_t, const std::vector<double>&)> differentials)
+         TFunctions functions)
+         requires SingleResidualJacobian<TFunctions, TDifferentials>
+         : _functions(std::move(functions))
       {
+         _Init(variableCount, funcCount);
+      }
+
+
+   private:
+
+      // Выделяет память под все рабочие буферы солвера
+      void _Init(size_t variableCount, size_t funcCount) {
          _varCount = variableCount;
          _funcCount = funcCount;
 
          _x.resize(variableCount);
          _dx.resize(variableCount);
-
-         _functions = functions;
-         _differentials = differentials;
+         _Fx.resize(funcCount);
+         _Ftrial.resize(funcCount);
+         _rowScale.assign(funcCount, 1.0);
+         _colScale.assign(variableCount, 1.0);
 
          size_t minSize = std::min(variableCount, funcCount);
          _mat.resize(minSize, minSize);
          _F.resize(minSize);
+         _dx_trim.resize(minSize);
+         _work.resize(minSize);
+         _grad.resize(minSize);
+         _cauchy.resize(minSize);
+         _step.resize(minSize);
+         _model.resize(minSize);
+         _cgResidual.resize(minSize);
+         _jac.resize(funcCount * variableCount);
+         _funcMap.resize(minSize);
+         _varMap.resize(minSize);
+         _rowScaleTrim.resize(minSize);
+         _colScaleTrim.resize(minSize);
 
          if (variableCount != funcCount)
          {
-            if (variableCount > funcCount)
-            {
-               _dx_trim.resize(funcCount);
-            }
-
             _mask.resize(std::max(variableCount, funcCount));
             _pairVec.resize(std::max(variableCount, funcCount));
          }
       }
 
+      // Выделяет память под профиль _profMat: по структуре матрицы Якоби, если она известна
+      // и система квадратная (строки и столбцы _mat тогда не переставляются), иначе - под
+      // максимально возможный (заполненный) профиль, так как профиль может меняться между итерациями
+      void _ReserveProfile() {
+         if (_profileReserved || _LeastSquares())
+            return;
 
-   private:
+         if (stepControl == StepControl::LevenbergMarquardt)
+         {
+            _profMat.Reserve(_varCount, _GetNormalProfileSize());
+            _profileReserved = true;
+            _allocations++;
+            return;
+         }
+
+         size_t minSize = std::min(_varCount, _funcCount);
+         size_t profSize = _hasSparsity && _varCount == _funcCount
+            ? _sparsity.ProfileSize()
+            : minSize * (minSize - (minSize > 0)) / 2;
+         _profMat.Reserve(minSize, profSize);
+         _profileReserved = true;
+         _allocations++;
+      }
+
+      // Размер профиля матрицы J^T J: элемент (i, j) не нулевой, если есть функция,
+      // зависящая и от x_i, и от x_j
+      size_t _GetNormalProfileSize() const {
+         size_t n = _varCount;
+         if (!_hasSparsity)
+            return n * (n - (n > 0)) / 2;
+
+         size_t size = 0;
+         for (size_t var = 0; var < n; var++)
+         {
+            size_t first = var;
+            for (size_t p = _sparsity.colBegin[var]; p < _sparsity.colBegin[var + 1]; p++)
+            {
+               // Переменные в строке упорядочены, первая - самая левая
+               first = std::min(first, _sparsity.cols[_sparsity.rowBegin[_sparsity.colRows[p]]]);
+            }
+            size += var - first;
+         }
+         return size;
+      }
+
+      // Выделяет память под QR-разложение
+      void _ReserveLeastSquares() {
+         if (!_LeastSquares() || _qr.Cols() != 0)
+            return;
+
+         _qr.Resize(std::max(_varCount, _funcCount), std::min(_varCount, _funcCount));
+         _qrRhs.resize(std::max(_varCount, _funcCount));
+         _allocations++;
+      }
+
+      // Выделяет память под шаг Чебышёва
+      void _ReserveSecondOrder() {
+         if (stepOrder != StepOrder::Chebyshev || !_secondX.empty())
+            return;
+
+         _secondX.resize(_varCount);
+         _secondPlus.resize(_funcCount);
+         _secondMinus.resize(_funcCount);
+         _secondStep.resize(_F.size());
+         _allocations++;
+      }
+
+      // Выделяет память под историю ускорения Андерсона
+      void _ReserveAnderson() {
+         if (andersonDepth == 0 || _andersonDX.size() >= andersonDepth)
+            return;
+
+         _andersonDX.resize(andersonDepth, std::vector<double>(_varCount));
+         _andersonDF.resize(andersonDepth, std::vector<double>(_varCount));
+         _andersonPrevX.resize(_varCount);
+         _andersonPrevF.resize(_varCount);
+         _andersonStep.resize(_varCount);
+         _andersonMixed.resize(_varCount);
+         _andersonF.resize(_funcCount);
+         _andersonQR.Resize(_varCount, std::min(andersonDepth, _varCount));
+         _allocations++;
+      }
+
+      // Выделяет память под матрицу метода Левенберга-Марквардта
+      void _ReserveLevenberg() {
+         if (stepControl != StepControl::LevenbergMarquardt || _normal.Rows() == _varCount)
+            return;
+
+         _normal.resize(_varCount, _varCount);
+         _normalDiag.resize(_varCount);
+         _gradFull.resize(_varCount);
+         _allocations++;
+      }
+
+      // Выделяет память под обновления Бройдена, если их стало нужно больше
+      void _ReserveBroyden() {
+         if (jacobianUpdate != JacobianUpdate::Broyden || _broydenS.size() >= broydenUpdates)
+            return;
+
+         _broydenA.resize(broydenUpdates, std::vector<double>(_F.size()));
+         _broydenS.resize(broydenUpdates, std::vector<double>(_F.size()));
+         _broydenZ.resize(broydenUpdates, std::vector<double>(_F.size()));
+         _broydenDen.resize(broydenUpdates);
+         _allocations++;
+      }
 
       // Определяет тип маски и получает маску, меняет _mask и _maskType
       inline void _GetMask();
 
-      // Находит матрицу Якоби с учётом маски и записывает её в _mat
+      // Находит полную матрицу Якоби в точке _x и записывает её в _jac
+      void _EvalJacobi();
+
+      // Переписывает матрицу Якоби с учётом маски в _mat
       void _GetJacobi();
 
+      // Записывает шаг метода в трассировку, если она включена
+      void _Trace(int it, const std::vector<double>& x, double prevEps, double eps);
+
+      // Находит масштабные множители по матрице _mat и масштабирует её
+      void _GetScaling();
+
       // Находит вектор функций F для решения системы
       void _GetF();
 
-      // Находит норму вектора из значений фунций F в точке x
-      double _GetNormF(const std::vector<double>& x) {
-         double res = 0;
-         double t;
-         for (size_t i = 0; i < _funcCount; i++)
+      // Считает матрицу Якоби в _x, выбирает маску, масштабирует и раскладывает матрицу,
+      // сбрасывает обновления Бройдена. Возвращает невязку в _x с новыми множителями
+      double _Refresh(double eps);
+
+      // Раскладывает матрицу _mat (со сдвигом диагонали для StepControl::PseudoTransient)
+      void _Factor();
+
+      // Псевдонестационарный шаг _dx: точку после шага записывает в trial, значения функций в ней -
+      // в _Ftrial, её невязку - в newEps. Если функции в новой точке не определены или невязка
+      // больше наименьшей в pseudoMaxGrowth раз, dt уменьшается.
+      // Возвращает false, если dt стал меньше criticalCoef от начального или невязка не уменьшалась
+      // pseudoStallSteps шагов подряд
+      bool _PseudoTransient(double eps, std::vector<double>& trial, double& newEps);
+
+      // x = B^{-1} rhs, где B - разложенная матрица _profMat с обновлениями Бройдена
+      void _ApplyInverse(std::vector<double>& x, const std::vector<double>& rhs);
+
+      // Матрица раскладывается на LU (не нужно только для StepControl::Steihaug)
+      bool _Factored() const {
+         return stepControl != StepControl::Steihaug;
+      }
+
+      // Находит шаг метода: _dx_trim в масштабированных переменных _mat и _dx в исходных
+      void _GetStep();
+
+      // Добавляет к шагу Ньютона _dx_trim поправку Чебышёва, если она мала по сравнению с самим шагом.
+      // _F заменяется на B _dx_trim (для обновлений Бройдена)
+      void _ChebyshevCorrection();
+
+      // Переводит шаг step в масштабированных переменных _mat в шаг _dx в исходных переменных
+      void _ExpandStep(const std::vector<double>& step);
+
+      // out = B x, где B - матрица _mat с обновлениями Бройдена
+      void _ModelProduct(const std::vector<double>& x, std::vector<double>& out) const;
+
+      // out = B^T y
+      void _ModelTransposed(const std::vector<double>& y, std::vector<double>& out) const;
+
+      // Шаг доверительной области радиуса _radius в _step: ломаная (_dx_trim - шаг Ньютона,
+      // если newton) или метод сопряжённых градиентов. gg = (_grad, _grad), tau - множитель точки Коши
+      void _DoglegStep(bool newton, double gg, double tau);
+      void _SteihaugStep(double gg);
+
+      // Шаг в доверительной области: точку после шага записывает в trial, значения функций в ней -
+      // в _Ftrial, её невязку - в newEps. Возвращает false, если радиус стал меньше criticalCoef
+      // от длины шага до точки Коши, а шаг так и не уменьшил невязку
+      bool _TrustRegion(double eps, std::vector<double>& trial, double& newEps);
+
+      // Подбирает длину шага coef вдоль _dx из точки _x (см. StepControl), точку после шага записывает
+      // в trial, значения функций в ней - в _Ftrial, её невязку - в newEps. Возвращает false,
+      // если подходящего шага не больше criticalCoef нет
+      bool _LineSearch(double eps, std::vector<double>& trial, double& coef, double& newEps);
+
+      // Шаг неквадратной системы ищется через QR-разложение (см. NonSquare)
+      bool _LeastSquares() const {
+         return _varCount != _funcCount && nonSquare == NonSquare::LeastSquares &&
+            (stepControl == StepControl::Halving || stepControl == StepControl::Armijo);
+      }
+
+      // Записывает матрицу Якоби (или транспонированную) в _qr и раскладывает её
+      void _GetQR();
+
+      // Считает J^T J и её диагональ по матрице Якоби _jac
+      void _GetNormal();
+
+      // Шаг метода Левенберга-Марквардта: точку после шага записывает в trial, значения функций в ней -
+      // в _Ftrial, её невязку - в newEps. Возвращает false, если шаг стал меньше criticalCoef от первого
+      // шага итерации, а невязка так и не уменьшилась
+      bool _Levenberg(double eps, std::vector<double>& trial, double& newEps);
+
+      // Обновление Бройдена самой матрицы Якоби _jac по шагу coef * _dx (для StepControl::LevenbergMarquardt
+      // и NonSquare::LeastSquares), после него матрица метода пересчитывается
+      bool _BroydenUpdateJacobian(double coef);
+
+      // Ускорение Андерсона принятой точки trial (с невязкой newEps) по истории шагов: смешанная точка
+      // заменяет trial, значения функций в ней - _Ftrial, только если её невязка меньше.
+      // Иначе история сбрасывается
+      void _Anderson(std::vector<double>& trial, double& newEps);
+
+      // Добавляет обновление Бройдена по принятому шагу s = coef * step (image = B step),
+      // значения функций после шага - в _Ftrial. Возвращает false, если обновление добавить нельзя
+      bool _BroydenUpdate(const std::vector<double>& step, double coef, const std::vector<double>& image);
+
+      // Находит значения всех функций F в точке x
+      void _EvalF(const std::vector<double>& x, std::vector<double>& values) {
+         if constexpr (FusedResidualJacobian<TFunctions>)
          {
-            t = _functions(i, x);
-            res += t * t;
+            _functions(x.data(), values.data(), nullptr);
          }
-         return std::sqrt(res);
+         else if constexpr (VectorResidual<TFunctions>)
+         {
+            // Общие для нескольких функций части пользователь считает один раз
+            _functions(x.data(), values.data());
+         }
+         else
+         {
+            for (size_t i = 0; i < _funcCount; i++)
+            {
+               values[i] = _functions(i, x);
+            }
+         }
+      }
+
+      // Находит норму вектора из значений фунций F в точке x, значения функций записывает в values
+      double _GetNormF(const std::vector<double>& x, std::vector<double>& values) {
+         _EvalF(x, values);
+         return _GetScaledNorm(values);
+      }
+
+      // Находит норму вектора значений функций с учётом масштабных множителей строк
+      double _GetScaledNorm(const std::vector<double>& values) const {
+         return Vec::ScaledNorm(_rowScale, values);
       }
 
 
@@ -199,10 +728,66 @@ namespace Newtons {
       // Максимальное число итераций
       int maxIter = 100;
 
+      // Тип автоматического масштабирования (эквилибрации) системы, см. ScalingType
+      ScalingType scaling = ScalingType::None;
+
+      // Число проходов масштабирования Ruiz'а
+      int ruizIterations = 5;
+
+      // Способ получения матрицы Якоби на итерациях, см. JacobianUpdate
+      JacobianUpdate jacobianUpdate = JacobianUpdate::Newton;
+
+      // Матрица Якоби считается заново, если невязка за итерацию уменьшилась меньше,
+      // чем в 1 / refreshRatio раз (только для обновляемых матриц, см. JacobianUpdate)
+      double refreshRatio = 0.5;
+
+      // Максимальное число обновлений Бройдена подряд, после которого матрица считается заново
+      size_t broydenUpdates = 20;
+
+      // Число итераций на одном разложении для JacobianUpdate::Chord, после которого матрица
+      // считается заново (0 - пока хватает сходимости, см. refreshRatio)
+      size_t refreshInterval = 0;
+
       // Критический коэффициент, после которого метод завершается с ошибкой сходимости
       // По умолчанию равен числу, соответствующему 6 дроблениям коэффициента на 2
       double criticalCoef = 1.0 / (1 << 6);
 
+      // Способ выбора длины шага, см. StepControl
+      StepControl stepControl = StepControl::Armijo;
+
+      // Порядок шага, см. StepOrder
+      StepOrder stepOrder = StepOrder::Newton;
+
+      // Шаг для неквадратных систем, см. NonSquare
+      NonSquare nonSquare = NonSquare::LeastSquares;
+
+      // Начальный радиус доверительной области в масштабированных переменных
+      // (0 - длина первого шага Ньютона)
+      double trustRadius = 0;
+
+      // Начальный параметр затухания метода Левенберга-Марквардта (в долях диагонали J^T J)
+      double damping = 1e-3;
+
+      // Начальный псевдовременной шаг StepControl::PseudoTransient (в масштабированных переменных)
+      double pseudoTimeStep = 1;
+
+      // Во сколько раз невязка псевдонестационарного шага может превышать наименьшую невязку за запуск Solve
+      double pseudoMaxGrowth = 10;
+
+      // Число псевдонестационарных шагов подряд без уменьшения наименьшей невязки, после которого
+      // метод завершается с ошибкой сходимости (-1). Уравнение dx/dt = -F устойчиво не при любой
+      // матрице Якоби, и без этого предела итерации могут уходить от корня до maxIter
+      size_t pseudoStallSteps = 50;
+
+      // Глубина ускорения Андерсона (0 - выключено): итерация метода рассматривается как
+      // неподвижная точка x -> x + coef dx, и новая точка смешивается из последних andersonDepth шагов.
+      // Полезно, когда сходимость линейная (JacobianUpdate::Chord, неточная матрица Якоби).
+      // Стоит одного вычисления функций за итерацию и 2 * andersonDepth векторов памяти
+      size_t andersonDepth = 0;
+
+      // Доля уменьшения невязки, достаточная для принятия шага в StepControl::Armijo
+      double armijo = 1e-4;
+
       // Метод для решения системы нелинейных уравнений
       // - init_x - начальное приближение, в том числе итоговое решение
       // - eps - полученная невязка решения
@@ -212,11 +797,1163 @@ namespace Newtons {
       // Положительное число - число итераций сходимости метода
       int Solve(std::vector<double>& init_x, double& eps, const bool debugOutput = false);
 
+      // Искать структуру матрицы Якоби при первом запуске Solve, если она не задана через SetSparsity.
+      // Найденная структура сохраняется в солвере и используется во всех следующих запусках
+      bool detectSparsity = false;
+
+      // Способ поиска структуры матрицы Якоби
+      SparsityProbe sparsityProbe = SparsityProbe::Perturbation;
+
+      // Задаёт структуру матрицы Якоби. Дифференциалы, заданные по одному, вызываются
+      // только для элементов структуры, остальные считаются нулями
+      void SetSparsity(JacobianSparsity sparsity) {
+         if (sparsity.funcCount != _funcCount || sparsity.varCount != _varCount)
+            throw std::runtime_error("Sparsity pattern size does not match the system.");
+
+         _sparsity = std::move(sparsity);
+         _hasSparsity = true;
+      }
+
+      // Структура матрицы Якоби или nullptr, если она не задана и ещё не найдена
+      const JacobianSparsity* Sparsity() const {
+         return _hasSparsity ? &_sparsity : nullptr;
+      }
+
       void EnableTracing(TraceVector& traceVector) {
          _traceVector = &traceVector;
          traceVector.Clear();
+         _allocations += traceVector.Reserve(maxIter + 1, _varCount);
+      }
+
+      // Число выделений памяти под рабочие буферы солвера после его создания.
+      // Все буферы резервируются в конструкторе, в EnableTracing и при первом запуске Solve, поэтому после первого
+      // (прогревочного) запуска Solve это число меняться не должно
+      size_t AllocationCount() const {
+         return _allocations;
+      }
+
+      // Решает J x = rhs (rhs - размера funcCount, x - varCount) с последней разложенной матрицей Якоби
+      // квадратной системы, с учётом обновлений Бройдена. Матрица считалась в начале последней итерации Solve
+      // (или раньше, если она переиспользовалась). Возвращает false, если такого разложения нет:
+      // система не квадратная, шаг ищется без LU (Steihaug, LevenbergMarquardt) или со сдвигом (PseudoTransient)
+      bool SolveLastJacobian(const std::vector<double>& rhs, std::vector<double>& x) {
+         if (!_jacobianFactored || _maskType != MaskType::None)
+            return false;
+
+         for (size_t k = 0; k < _work.size(); k++)
+         {
+            size_t func = _funcMap[k];
+            _work[k] = _rowScale[func] * rhs[func];
+         }
+         _ApplyInverse(_dx_trim, _work);
+         for (size_t k = 0; k < _dx_trim.size(); k++)
+         {
+            size_t var = _varMap[k];
+            x[var] = _colScale[var] * _dx_trim[k];
+         }
+         return true;
       }
    };
 
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_GetMask() {
+      if (_varCount == _funcCount)
+      {
+         _maskType = MaskType::None;
+
+         for (size_t i = 0; i < _funcCount; i++)
+         {
+            _funcMap[i] = i;
+            _varMap[i] = i;
+         }
+      }
+       else if (_varCount < _funcCount)
+       {
+           size_t delta = _funcCount - _varCount;
+
+           // Найдём для каждой функции их абсолютное (масштабированное) значение в точке х
+           for (size_t i = 0; i < _funcCount; i++)
+           {
+               _pairVec[i].first = i;
+               _pairVec[i].second = std::abs(_rowScale[i] * _Fx[i]);
+           }
+
+           // Сортируем эту последовательность по возрастанию значений
+           std::sort(_pairVec.begin(), _pairVec.end(), [](const std::pair<size_t, double>& l, const std::pair<size_t, double>& r)
+               {
+                   return l.second < r.second;
+               }
+           );
+
+           // Исключаем индексы первых delta элементов из расчётов (помечаем их нулями в маске)
+           size_t i;
+           for (i = 0; i < delta; i++)
+           {
+               _mask[_pairVec[i].first] = false;
+           }
+
+           // Остальные помечаем единицами
+           for (i; i < _funcCount; i++)
+           {
+               _mask[_pairVec[i].first] = true;
+           }
+
+           for (size_t func = 0, k = 0; func < _funcCount; func++)
+           {
+               if (_mask[func])
+               {
+                   _funcMap[k] = func;
+                   _varMap[k] = k;
+                   k++;
+               }
+           }
+
+           _maskType = MaskType::MoreFuncs;
+       }
+
+       else // _varCount > _funcCount
+       {
+           size_t delta = _varCount - _funcCount;
+
+           // Найдём для каждой переменной максимальное абсолютное значение среди прозводных функций
+           for (size_t i = 0; i < _varCount; i++)
+           {
+               _pairVec[i].first = i;
+
+               // Перебираем производные всех функций, находим максимум для i переменной
+               double a = 0;
+               for (size_t k = 0; k < _funcCount; k++)
+               {
+                   a = std::max(a, std::abs(_rowScale[k] * _jac[k * _varCount + i]));
+               }
+               _pairVec[i].second = a * _colScale[i];
+           }
+
+           // Сортируем эту последовательность по возрастанию значений
+           std::sort(_pairVec.begin(), _pairVec.end(), [](const std::pair<size_t, double>& l, const std::pair<size_t, double>& r)
+               {
+                   return l.second < r.second;
+               }
+           );
+
+           // Исключаем индексы первых delta элементов из расчётов (помечаем их нулями в маске)
+           size_t i;
+           for (i = 0; i < delta; i++)
+           {
+               _mask[_pairVec[i].first] = false;
+           }
+
+           // Остальные помечаем единицами
+           for (i; i < _varCount; i++)
+           {
+               _mask[_pairVec[i].first] = true;
+           }
+
+           for (size_t var = 0, k = 0; var < _varCount; var++)
+           {
+               if (_mask[var])
+               {
+                   _funcMap[k] = k;
+                   _varMap[k] = var;
+                   k++;
+               }
+           }
+
+           _maskType = MaskType::MoreVars;
+       }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_EvalJacobi() {
+      if constexpr (DenseJacobianFromResidual<TDifferentials>)
+      {
+         _differentials(_x.data(), _Fx.data(), _jac.data());
+      }
+      else if constexpr (_single)
+      {
+         // Значения функций в _x при этом пересчитываются те же самые
+         _functions(_x.data(), _Fx.data(), _jac.data());
+      }
+      else if constexpr (FusedResidualJacobian<TDifferentials>)
+      {
+         _differentials(_x.data(), _Fx.data(), _jac.data());
+      }
+      else if constexpr (DenseJacobian<TDifferentials>)
+      {
+         _differentials(_x.data(), _jac.data());
+      }
+      else if constexpr (TripletJacobian<TDifferentials>)
+      {
+         std::fill(_jac.begin(), _jac.end(), 0.0);
+         JacobianTriplets triplets(_jac.data(), _varCount);
+         _differentials(_x.data(), triplets);
+      }
+      else if (_hasSparsity)
+      {
+         // Структурные нули не вычисляем
+         std::fill(_jac.begin(), _jac.end(), 0.0);
+         for (size_t func = 0; func < _funcCount; func++)
+         {
+            for (size_t k = _sparsity.rowBegin[func]; k < _sparsity.rowBegin[func + 1]; k++)
+            {
+               size_t var = _sparsity.cols[k];
+               _jac[func * _varCount + var] = _differentials(func, var, _x);
+            }
+         }
+      }
+      else
+      {
+         for (size_t func = 0; func < _funcCount; func++)
+         {
+            for (size_t var = 0; var < _varCount; var++)
+            {
+               _jac[func * _varCount + var] = _differentials(func, var, _x);
+            }
+         }
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_GetJacobi() {
+      // Строки и столбцы, исключённые маской, в _funcMap и _varMap не попадают
+      for (size_t i = 0; i < _mat.Rows(); i++)
+      {
+         const double* row = _jac.data() + _funcMap[i] * _varCount;
+         for (size_t j = 0; j < _mat.Cols(); j++)
+         {
+            _mat(i, j) = row[_varMap[j]];
+         }
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_Trace(int it, const std::vector<double>& x, double prevEps, double eps) {
+      if (!_traceVector)
+         return;
+
+      // Элементы трассировки переиспользуются, поэтому копирование не выделяет новую память
+      TraceElement& elem = _traceVector->Next();
+      elem.iterationNum = it;
+      elem.prevX = _x;
+      elem.X = x;
+      elem.dX = _dx;
+      elem.prevEps = prevEps;
+      elem.eps = eps;
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_GetScaling() {
+      if (scaling == ScalingType::None)
+         return;
+
+      size_t size = _mat.Rows();
+      std::fill(_rowScaleTrim.begin(), _rowScaleTrim.end(), 1.0);
+      std::fill(_colScaleTrim.begin(), _colScaleTrim.end(), 1.0);
+
+      int passes = scaling == ScalingType::Ruiz ? ruizIterations : 1;
+      for (int pass = 0; pass < passes; pass++)
+      {
+         // Множители строк по максимальному элементу строки уже масштабированной матрицы
+         for (size_t i = 0; i < size; i++)
+         {
+            double a = 0;
+            for (size_t j = 0; j < size; j++)
+            {
+               a = std::max(a, std::abs(_rowScaleTrim[i] * _mat(i, j) * _colScaleTrim[j]));
+            }
+            if (a > 0)
+            {
+               _rowScaleTrim[i] /= scaling == ScalingType::Ruiz ? std::sqrt(a) : a;
+            }
+         }
+
+         // Множители столбцов по максимальному элементу столбца
+         for (size_t j = 0; j < size; j++)
+         {
+            double a = 0;
+            for (size_t i = 0; i < size; i++)
+            {
+               a = std::max(a, std::abs(_rowScaleTrim[i] * _mat(i, j) * _colScaleTrim[j]));
+            }
+            if (a > 0)
+            {
+               _colScaleTrim[j] /= scaling == ScalingType::Ruiz ? std::sqrt(a) : a;
+            }
+         }
+      }
+
+      // Округляем множители до степени двойки: масштабирование тогда не вносит ошибок округления,
+      // а сами множители меняются между итерациями только при заметном изменении матрицы Якоби
+      for (size_t k = 0; k < size; k++)
+      {
+         _rowScaleTrim[k] = std::exp2(std::round(std::log2(_rowScaleTrim[k])));
+         _colScaleTrim[k] = std::exp2(std::round(std::log2(_colScaleTrim[k])));
+         _rowScale[_funcMap[k]] = _rowScaleTrim[k];
+         _colScale[_varMap[k]] = _colScaleTrim[k];
+      }
+
+      for (size_t i = 0; i < size; i++)
+      {
+         for (size_t j = 0; j < size; j++)
+         {
+            _mat(i, j) *= _rowScaleTrim[i] * _colScaleTrim[j];
+         }
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_GetF() {
+      // Значения функций в точке _x уже посчитаны при нахождении невязки
+      for (size_t k = 0; k < _F.size(); k++)
+      {
+         size_t func = _funcMap[k];
+         _F[k] = -_rowScale[func] * _Fx[func];
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   double BasicNewtonsSolver<TFunctions, TDifferentials>::_Refresh(double eps) {
+      _EvalJacobi();
+      _broydenCount = 0;
+      _jacobianFactored = false;
+      if (stepControl == StepControl::LevenbergMarquardt)
+      {
+         // Маска и масштабирование не нужны - система решается по всем функциям и переменным
+         _GetNormal();
+         return eps;
+      }
+      if (_LeastSquares())
+      {
+         // Масштабирование строк изменило бы задачу наименьших квадратов, поэтому не используется
+         _GetQR();
+         return eps;
+      }
+
+      _GetMask();
+      _GetJacobi();
+      if (scaling != ScalingType::None)
+      {
+         // Множители могли измениться - пересчитываем невязку по уже известным значениям функций
+         _GetScaling();
+         eps = _GetScaledNorm(_Fx);
+      }
+      if (_Factored())
+      {
+         _Factor();
+      }
+      return eps;
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_Factor() {
+      size_t profCapacity = _profMat.al.capacity();
+      _profMat.MakeFromMatrix(_mat);
+      if (_profMat.al.capacity() != profCapacity)
+      {
+         _allocations++;
+      }
+      if (stepControl == StepControl::PseudoTransient)
+      {
+         for (auto& el : _profMat.diag)
+         {
+            el += 1 / _timeStep;
+         }
+      }
+      _profMat.LUdecompose();
+      _jacobianFactored = stepControl != StepControl::PseudoTransient;
+   }
+
+   template <class TFunctions, class TDifferentials>
+   bool BasicNewtonsSolver<TFunctions, TDifferentials>::_PseudoTransient(double eps, std::vector<double>& trial, double& newEps) {
+      while (true)
+      {
+         Vec::AddVec(_x, 1, _dx, trial);
+         newEps = _GetNormF(trial, _Ftrial);
+         double norm = Vec::Norm(_Ftrial);
+         if (norm <= pseudoMaxGrowth * _pseudoBest)
+         {
+            // Switched evolution relaxation: dt обратно пропорционален невязке
+            _timeStep = std::min(_timeStep * eps / newEps, 1e300);
+            if (norm < _pseudoBest)
+            {
+               _pseudoBest = norm;
+               _pseudoStall = 0;
+               return true;
+            }
+            return ++_pseudoStall < pseudoStallSteps;
+         }
+
+         // Шаг увёл за область определения функций или слишком далеко - уменьшаем dt
+         // и решаем заново с той же матрицей
+         _timeStep /= 10;
+         if (_timeStep < criticalCoef * pseudoTimeStep)
+            return false;
+         _Factor();
+         _broydenCount = 0;
+         _GetStep();
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_ApplyInverse(std::vector<double>& x, const std::vector<double>& rhs) {
+      LU::ProfileSolver::Solve(_profMat, x, rhs);
+
+      // (B + a s^T)^{-1} r = B^{-1} r - z (s, B^{-1} r) / den, z = B^{-1} a, den = 1 + (s, z)
+      for (size_t i = 0; i < _broydenCount; i++)
+      {
+         double t = Vec::Scalar(_broydenS[i], x) / _broydenDen[i];
+         Vec::AddVec(x, -t, _broydenZ[i], x);
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_GetStep() {
+      if (stepControl == StepControl::LevenbergMarquardt)
+      {
+         // -J^T F, значения функций в _x уже посчитаны
+         std::fill(_gradFull.begin(), _gradFull.end(), 0.0);
+         for (size_t func = 0; func < _funcCount; func++)
+         {
+            const double* row = _jac.data() + func * _varCount;
+            for (size_t var = 0; var < _varCount; var++)
+            {
+               _gradFull[var] -= row[var] * _Fx[func];
+            }
+         }
+         return;
+      }
+
+      if (_LeastSquares())
+      {
+         std::fill(_qrRhs.begin(), _qrRhs.end(), 0.0);
+         for (size_t func = 0; func < _funcCount; func++)
+         {
+            _qrRhs[func] = -_Fx[func];
+         }
+
+         if (_funcCount > _varCount)
+         {
+            // J = Q R: dx = R^{-1} (Q^T (-F)) по первым n элементам
+            _qr.MultiplyQt(_qrRhs);
+            _qr.SolveR(_qrRhs);
+         }
+         else
+         {
+            // J^T = Q R: J dx = R^T Q^T dx = -F, решение наименьшей длины dx = Q (R^{-T} (-F), 0)
+            _qr.SolveRt(_qrRhs);
+            _qr.MultiplyQ(_qrRhs);
+         }
+         std::copy(_qrRhs.begin(), _qrRhs.begin() + _varCount, _dx.begin());
+         return;
+      }
+
+      _GetF();
+      if (!_Factored())
+         return;
+
+      _ApplyInverse(_dx_trim, _F);
+      _ExpandStep(_dx_trim);
+
+      if (stepOrder == StepOrder::Chebyshev && (stepControl == StepControl::Halving || stepControl == StepControl::Armijo))
+      {
+         _ChebyshevCorrection();
+         _ExpandStep(_dx_trim);
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_ChebyshevCorrection() {
+      double norm = Vec::Norm(_dx);
+      if (!(norm > 0) || !std::isfinite(norm))
+         return;
+
+      // F''[a, a] ~ (F(x + h a) - 2 F(x) + F(x - h a)) / h^2, шаг ~ eps^(1/4) от масштаба x
+      double h = 1e-4 * (1 + Vec::Norm(_x)) / norm;
+      Vec::AddVec(_x, h, _dx, _secondX);
+      _EvalF(_secondX, _secondPlus);
+      Vec::AddVec(_x, -h, _dx, _secondX);
+      _EvalF(_secondX, _secondMinus);
+
+      for (size_t k = 0; k < _work.size(); k++)
+      {
+         size_t func = _funcMap[k];
+         double second = (_secondPlus[func] - 2 * _Fx[func] + _secondMinus[func]) / (h * h);
+         _work[k] = -0.5 * _rowScale[func] * second;
+      }
+      _ApplyInverse(_secondStep, _work);
+
+      // Далеко от корня ряд Тейлора не работает, и поправка только портит шаг Ньютона
+      if (!(Vec::Norm(_secondStep) <= 0.5 * Vec::Norm(_dx_trim)))
+         return;
+
+      Vec::AddVec(_dx_trim, 1, _secondStep, _dx_trim);
+      Vec::AddVec(_F, 1, _work, _F);
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_ExpandStep(const std::vector<double>& step) {
+      // Переписываем обрезанный вектор в полноценный _dx и возвращаемся
+      // от масштабированных переменных к исходным
+      std::fill(_dx.begin(), _dx.end(), 0.0);
+      for (size_t k = 0; k < step.size(); k++)
+      {
+         size_t var = _varMap[k];
+         _dx[var] = _colScale[var] * step[k];
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_ModelProduct(const std::vector<double>& x, std::vector<double>& out) const {
+      for (size_t i = 0; i < out.size(); i++)
+      {
+         out[i] = Vec::Scalar(_mat.elems[i], x);
+      }
+      for (size_t i = 0; i < _broydenCount; i++)
+      {
+         Vec::AddVec(out, Vec::Scalar(_broydenS[i], x), _broydenA[i], out);
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_ModelTransposed(const std::vector<double>& y, std::vector<double>& out) const {
+      std::fill(out.begin(), out.end(), 0.0);
+      for (size_t i = 0; i < y.size(); i++)
+      {
+         if (y[i] != 0)
+         {
+            Vec::AddVec(out, y[i], _mat.elems[i], out);
+         }
+      }
+      for (size_t i = 0; i < _broydenCount; i++)
+      {
+         Vec::AddVec(out, Vec::Scalar(_broydenA[i], y), _broydenS[i], out);
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_DoglegStep(bool newton, double gg, double tau) {
+      if (newton && Vec::Norm(_dx_trim) <= _radius)
+      {
+         _step = _dx_trim;
+         return;
+      }
+
+      // Точка Коши - минимум модели вдоль направления наискорейшего спуска
+      double cauchyNorm = tau * std::sqrt(gg);
+      if (!newton || cauchyNorm >= _radius)
+      {
+         double coef = std::min(_radius, cauchyNorm) / std::sqrt(gg);
+         for (size_t k = 0; k < _step.size(); k++)
+         {
+            _step[k] = coef * _grad[k];
+         }
+         return;
+      }
+
+      // Точка пересечения отрезка от точки Коши к шагу Ньютона с границей области
+      for (size_t k = 0; k < _step.size(); k++)
+      {
+         _cauchy[k] = tau * _grad[k];
+         _step[k] = _dx_trim[k] - _cauchy[k];
+      }
+      double a = Vec::Scalar(_step, _step);
+      double b = Vec::Scalar(_cauchy, _step);
+      double c = cauchyNorm * cauchyNorm - _radius * _radius;
+      double t = (-b + std::sqrt(b * b - a * c)) / a;
+      Vec::AddVec(_cauchy, t, _step, _step);
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_SteihaugStep(double gg) {
+      // Сопряжённые градиенты для B^T B p = B^T F из p = 0: невязка _cgResidual, направление _cauchy
+      std::fill(_step.begin(), _step.end(), 0.0);
+      _cgResidual = _grad;
+      _cauchy = _grad;
+
+      double rr = gg;
+      double tolerance = std::min(0.5, std::sqrt(std::sqrt(gg))) * std::sqrt(gg);
+      for (size_t j = 0; j < _step.size(); j++)
+      {
+         _ModelProduct(_cauchy, _model);
+         double curvature = Vec::Scalar(_model, _model);
+         double pp = Vec::Scalar(_step, _step);
+         double pd = Vec::Scalar(_step, _cauchy);
+         double dd = Vec::Scalar(_cauchy, _cauchy);
+         double alpha = rr / curvature;
+
+         if (!(curvature > 0) && std::isinf(_radius))
+            return;
+         if (!(curvature > 0) || pp + alpha * (2 * pd + alpha * dd) >= _radius * _radius)
+         {
+            // Идём по направлению до границы области
+            double t = (-pd + std::sqrt(pd * pd + dd * (_radius * _radius - pp))) / dd;
+            Vec::AddVec(_step, t, _cauchy, _step);
+            return;
+         }
+
+         Vec::AddVec(_step, alpha, _cauchy, _step);
+         _ModelTransposed(_model, _work);
+         Vec::AddVec(_cgResidual, -alpha, _work, _cgResidual);
+
+         double rrNew = Vec::Scalar(_cgResidual, _cgResidual);
+         if (std::sqrt(rrNew) <= tolerance)
+            return;
+
+         Vec::AddVec(_cgResidual, rrNew / rr, _cauchy, _cauchy);
+         rr = rrNew;
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   bool BasicNewtonsSolver<TFunctions, TDifferentials>::_TrustRegion(double eps, std::vector<double>& trial, double& newEps) {
+      // Модель m(p) = ||B p - F||^2, её направление наискорейшего спуска B^T F
+      _ModelTransposed(_F, _grad);
+      double gg = Vec::Scalar(_grad, _grad);
+      if (gg == 0)
+      {
+         // Модель стационарна - шага нет, невязка не меняется
+         newEps = eps;
+         return false;
+      }
+      _ModelProduct(_grad, _model);
+      double tau = gg / Vec::Scalar(_model, _model);
+      double minRadius = criticalCoef * tau * std::sqrt(gg);
+
+      bool newton = _Factored();
+      for (size_t k = 0; newton && k < _dx_trim.size(); k++)
+      {
+         newton = std::isfinite(_dx_trim[k]);
+      }
+
+      bool first = _radius <= 0;
+      if (first)
+      {
+         _radius = std::numeric_limits<double>::infinity();
+      }
+
+      double FF = Vec::Scalar(_F, _F);
+      while (true)
+      {
+         if (stepControl == StepControl::Dogleg)
+            _DoglegStep(newton, gg, tau);
+         else
+            _SteihaugStep(gg);
+
+         double stepNorm = Vec::Norm(_step);
+         if (first)
+         {
+            _radius = stepNorm;
+            first = false;
+         }
+
+         _ModelProduct(_step, _model);
+         double modelNorm = Vec::AddVecNorm(_model, -1, _F, _work);
+         double predicted = FF - modelNorm * modelNorm;
+
+         _ExpandStep(_step);
+         Vec::AddVec(_x, 1, _dx, trial);
+         newEps = _GetNormF(trial, _Ftrial);
+         double actual = eps * eps - newEps * newEps;
+         double rho = predicted > 0 ? actual / predicted : -1;
+
+         if (!(rho >= 0.25))
+            _radius = 0.25 * stepNorm;
+         else if (rho > 0.75 && stepNorm >= 0.99 * _radius)
+            _radius = 2 * stepNorm;
+
+         if (rho > 1e-4)
+            return true;
+         if (_radius < minRadius)
+            return false;
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   bool BasicNewtonsSolver<TFunctions, TDifferentials>::_LineSearch(double eps, std::vector<double>& trial, double& coef, double& newEps) {
+      if (stepControl == StepControl::Halving)
+      {
+         coef = 2;
+         newEps = eps;
+         while (eps <= newEps && coef > criticalCoef)
+         {
+            coef /= 2;
+            Vec::AddVec(_x, coef, _dx, trial);
+            newEps = _GetNormF(trial, _Ftrial);
+         }
+         return coef > criticalCoef;
+      }
+
+      // Модель f(coef) = ||F(x + coef dx)||^2, для шага Ньютона f'(0) = -2 ||F||^2
+      const double f0 = eps * eps;
+      const double slope = -2 * f0;
+      double prevCoef = 0, prevF = 0;
+
+      coef = 1;
+      while (true)
+      {
+         Vec::AddVec(_x, coef, _dx, trial);
+         newEps = _GetNormF(trial, _Ftrial);
+         if (newEps <= (1 - armijo * coef) * eps)
+            return true;
+         if (coef <= criticalCoef)
+            return false;
+
+         double f = newEps * newEps;
+         double next;
+         if (!std::isfinite(f))
+         {
+            next = 0.5 * coef;
+         }
+         else if (prevCoef == 0)
+         {
+            // Минимум параболы по f(0), f'(0) и f(coef)
+            next = -slope * coef * coef / (2 * (f - f0 - slope * coef));
+         }
+         else
+         {
+            // Минимум кубической модели по f(0), f'(0) и двум последним пробным шагам
+            double r1 = (f - f0 - slope * coef) / (coef * coef);
+            double r2 = (prevF - f0 - slope * prevCoef) / (prevCoef * prevCoef);
+            double a = (r1 - r2) / (coef - prevCoef);
+            double b = (coef * r2 - prevCoef * r1) / (coef - prevCoef);
+            double disc = b * b - 3 * a * slope;
+            if (a == 0)
+               next = -slope / (2 * b);
+            else if (disc < 0)
+               next = 0.5 * coef;
+            else if (b <= 0)
+               next = (-b + std::sqrt(disc)) / (3 * a);
+            else
+               next = -slope / (b + std::sqrt(disc));
+         }
+
+         // Шаг не должен уменьшаться слишком сильно или слишком слабо
+         if (!(next >= 0.1 * coef))
+            next = 0.1 * coef;
+         if (next > 0.5 * coef)
+            next = 0.5 * coef;
+
+         prevCoef = coef;
+         prevF = f;
+         coef = std::max(next, criticalCoef);
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_Anderson(std::vector<double>& trial, double& newEps) {
+      // Шаг неподвижной точки f_k = g(x_k) - x_k и разности с предыдущей итерацией
+      Vec::AddVec(trial, -1, _x, _andersonStep);
+      if (_andersonHasPrev)
+      {
+         Vec::AddVec(_x, -1, _andersonPrevX, _andersonDX[_andersonNext]);
+         Vec::AddVec(_andersonStep, -1, _andersonPrevF, _andersonDF[_andersonNext]);
+         _andersonNext = (_andersonNext + 1) % andersonDepth;
+         _andersonStored = std::min(_andersonStored + 1, andersonDepth);
+      }
+      _andersonPrevX = _x;
+      _andersonPrevF = _andersonStep;
+      _andersonHasPrev = true;
+
+      size_t count = _andersonStored;
+      if (count == 0 || count > _varCount)
+         return;
+
+      // gamma = argmin ||f_k - DF gamma||
+      _andersonQR.Resize(_varCount, count);
+      for (size_t c = 0; c < count; c++)
+      {
+         for (size_t i = 0; i < _varCount; i++)
+         {
+            _andersonQR(i, c) = _andersonDF[c][i];
+         }
+      }
+      _andersonQR.Decompose();
+      _andersonQR.MultiplyQt(_andersonStep);
+      _andersonQR.SolveR(_andersonStep);
+
+      // x_mix = g(x_k) - (DX + DF) gamma
+      _andersonMixed = trial;
+      for (size_t c = 0; c < count; c++)
+      {
+         Vec::AddVec(_andersonMixed, -_andersonStep[c], _andersonDX[c], _andersonMixed);
+         Vec::AddVec(_andersonMixed, -_andersonStep[c], _andersonDF[c], _andersonMixed);
+      }
+
+      double mixedEps = _GetNormF(_andersonMixed, _andersonF);
+      if (mixedEps < newEps)
+      {
+         std::swap(trial, _andersonMixed);
+         std::swap(_Ftrial, _andersonF);
+         newEps = mixedEps;
+      }
+      else
+      {
+         // Смесь хуже обычного шага (или не определена) - история больше не описывает итерацию
+         _andersonStored = 0;
+         _andersonNext = 0;
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_GetQR() {
+      for (size_t func = 0; func < _funcCount; func++)
+      {
+         const double* row = _jac.data() + func * _varCount;
+         for (size_t var = 0; var < _varCount; var++)
+         {
+            if (_funcCount > _varCount)
+               _qr(func, var) = row[var];
+            else
+               _qr(var, func) = row[var];
+         }
+      }
+      _qr.Decompose();
+   }
+
+   template <class TFunctions, class TDifferentials>
+   void BasicNewtonsSolver<TFunctions, TDifferentials>::_GetNormal() {
+      for (auto& row : _normal.elems)
+      {
+         std::fill(row.begin(), row.end(), 0.0);
+      }
+
+      // J^T J по строкам J, нулевые элементы строк пропускаются
+      for (size_t func = 0; func < _funcCount; func++)
+      {
+         const double* row = _jac.data() + func * _varCount;
+         for (size_t i = 0; i < _varCount; i++)
+         {
+            if (row[i] == 0)
+               continue;
+            std::vector<double>& normalRow = _normal.elems[i];
+            for (size_t j = 0; j < _varCount; j++)
+            {
+               normalRow[j] += row[i] * row[j];
+            }
+         }
+      }
+
+      // Переменные, от которых ничего не зависит, затухают с единичным масштабом
+      for (size_t i = 0; i < _varCount; i++)
+      {
+         _normalDiag[i] = _normal(i, i) > 0 ? _normal(i, i) : 1.0;
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   bool BasicNewtonsSolver<TFunctions, TDifferentials>::_Levenberg(double eps, std::vector<double>& trial, double& newEps) {
+      if (Vec::Norm(_gradFull) == 0)
+      {
+         // J^T F = 0 - точка стационарна для ||F||^2, шага нет
+         newEps = eps;
+         return false;
+      }
+
+      double firstNorm = -1;
+      while (true)
+      {
+         size_t profCapacity = _profMat.al.capacity();
+         _profMat.MakeFromMatrix(_normal);
+         if (_profMat.al.capacity() != profCapacity)
+         {
+            _allocations++;
+         }
+         for (size_t i = 0; i < _varCount; i++)
+         {
+            _profMat.diag[i] += _damping * _normalDiag[i];
+         }
+         _profMat.LUdecompose();
+         LU::ProfileSolver::Solve(_profMat, _dx, _gradFull);
+
+         double stepNorm = Vec::Norm(_dx);
+         if (firstNorm < 0)
+         {
+            firstNorm = stepNorm;
+         }
+
+         // ||F||^2 - ||F + J dx||^2 = (dx, -J^T F) + lambda (dx, D dx)
+         double predicted = Vec::Scalar(_dx, _gradFull);
+         for (size_t i = 0; i < _varCount; i++)
+         {
+            predicted += _damping * _normalDiag[i] * _dx[i] * _dx[i];
+         }
+
+         Vec::AddVec(_x, 1, _dx, trial);
+         newEps = _GetNormF(trial, _Ftrial);
+         double rho = predicted > 0 ? (eps * eps - newEps * newEps) / predicted : -1;
+
+         // Затухание по Нильсену: уменьшается тем сильнее, чем точнее модель
+         if (rho > 0)
+         {
+            double t = 2 * rho - 1;
+            _damping *= std::max(1.0 / 3, 1 - t * t * t);
+            _dampingGrowth = 2;
+            return true;
+         }
+
+         _damping *= _dampingGrowth;
+         _dampingGrowth *= 2;
+         if (!(stepNorm > criticalCoef * firstNorm))
+            return false;
+      }
+   }
+
+   template <class TFunctions, class TDifferentials>
+   bool BasicNewtonsSolver<TFunctions, TDifferentials>::_BroydenUpdateJacobian(double coef) {
+      if (_broydenCount >= broydenUpdates)
+         return false;
+
+      double ss = coef * coef * Vec::Scalar(_dx, _dx);
+      if (ss == 0)
+         return false;
+
+      // J += (y - J s) s^T / (s, s), s = coef * _dx
+      for (size_t func = 0; func < _funcCount; func++)
+      {
+         double* row = _jac.data() + func * _varCount;
+         double residual = _Ftrial[func] - _Fx[func];
+         for (size_t var = 0; var < _varCount; var++)
+         {
+            residual -= coef * row[var] * _dx[var];
+         }
+         residual *= coef / ss;
+         for (size_t var = 0; var < _varCount; var++)
+         {
+            row[var] += residual * _dx[var];
+         }
+      }
+      if (stepControl == StepControl::LevenbergMarquardt)
+         _GetNormal();
+      else
+         _GetQR();
+
+      _broydenCount++;
+      return true;
+   }
+
+   template <class TFunctions, class TDifferentials>
+   bool BasicNewtonsSolver<TFunctions, TDifferentials>::_BroydenUpdate(const std::vector<double>& step, double coef, const std::vector<double>& image) {
+      if (_broydenCount >= _broydenS.size())
+         return false;
+
+      std::vector<double>& a = _broydenA[_broydenCount];
+      std::vector<double>& s = _broydenS[_broydenCount];
+      std::vector<double>& z = _broydenZ[_broydenCount];
+
+      // a = (y - B s) / (s, s), y - изменение масштабированных функций за шаг
+      for (size_t k = 0; k < s.size(); k++)
+      {
+         size_t func = _funcMap[k];
+         s[k] = coef * step[k];
+         a[k] = _rowScale[func] * (_Ftrial[func] - _Fx[func]) - coef * image[k];
+      }
+      double ss = Vec::Scalar(s, s);
+      if (ss == 0)
+         return false;
+      for (auto& el : a)
+      {
+         el /= ss;
+      }
+
+      // Без разложения матрицы обновление нужно только для произведений B p
+      if (_Factored())
+      {
+         _ApplyInverse(z, a);
+         double den = 1 + Vec::Scalar(s, z);
+         if (!(std::abs(den) > 1e-12))
+            return false;
+         _broydenDen[_broydenCount] = den;
+      }
+
+      _broydenCount++;
+      return true;
+   }
+
+   // Метод для решения системы нелинейных уравнений
+   // - init_x - начальное приближение, в том числе итоговое решение
+   // - eps - полученная невязка решения
+   // Возможный возврат:
+   // - [-1] - ошибка сходимости (при любом допустимо возможном шаге невязка возрастает)
+   // - [-2] - выход по превышению числа итераций
+   // - [-3] - ошибка сходимости (метод не может иметь направления движения)
+   // - [Положительное число] - число итераций сходимости метода
+
+   template <class TFunctions, class TDifferentials>
+   int BasicNewtonsSolver<TFunctions, TDifferentials>::Solve(std::vector<double>& init_x, double& eps, const bool debugOutput) {
+      std::swap(init_x, _x);
+      eps = _GetNormF(_x, _Fx);
+
+      if (detectSparsity && !_hasSparsity)
+      {
+         _sparsity = DetectSparsity(
+            [this](const std::vector<double>& x, std::vector<double>& values) { _EvalF(x, values); },
+            _funcCount, _varCount, _x, sparsityProbe);
+         _hasSparsity = true;
+      }
+      _ReserveProfile();
+
+      if (_traceVector)
+      {
+         _allocations += _traceVector->Reserve(maxIter + 1, _varCount);
+      }
+      _ReserveBroyden();
+      _ReserveLevenberg();
+      _ReserveLeastSquares();
+      _ReserveAnderson();
+      _ReserveSecondOrder();
+      _andersonStored = 0;
+      _andersonNext = 0;
+      _andersonHasPrev = false;
+
+      // Нужно ли считать матрицу Якоби заново на этой итерации
+      bool refresh = true;
+      bool trustRegion = stepControl == StepControl::Dogleg || stepControl == StepControl::Steihaug;
+      bool levenberg = stepControl == StepControl::LevenbergMarquardt;
+      _radius = trustRadius;
+      _damping = damping;
+      _dampingGrowth = 2;
+      _timeStep = pseudoTimeStep;
+      _pseudoBest = Vec::Norm(_Fx);
+      _pseudoStall = 0;
+      bool pseudoTransient = stepControl == StepControl::PseudoTransient;
+
+      // Число итераций на текущем разложении матрицы
+      size_t reused = 0;
+
+      int it;
+      for (it = 1; it <= maxIter && eps > minEps; it++)
+      {
+         bool fresh = refresh || jacobianUpdate == JacobianUpdate::Newton;
+         if (fresh)
+         {
+            eps = _Refresh(eps);
+            refresh = false;
+            reused = 0;
+         }
+         _GetStep();
+
+         for (size_t i = 0; i < _dx.size() && !trustRegion && !levenberg && !pseudoTransient; i++)
+         {
+            double el = _dx[i];
+            if (std::abs(el) == std::numeric_limits<double>::infinity())
+            {
+               if (!fresh)
+               {
+                  // Обновлённая матрица выродилась - пробуем ту же итерацию с настоящей
+                  refresh = true;
+                  break;
+               }
+               if (debugOutput)
+               {
+                  std::cout << "Выход по ошибке сходимости: методу некуда идти.\nПопробуйте сместить начальную точку в сторону.\n\n";
+               }
+               _Trace(it, _x, eps, eps);
+               std::swap(_x, init_x);
+
+               return -3;
+            }
+         }
+         if (refresh)
+         {
+            it--;
+            continue;
+         }
+
+         double coef = 1, newEps = eps;
+         bool accepted = pseudoTransient ? _PseudoTransient(eps, init_x, newEps)
+            : levenberg ? _Levenberg(eps, init_x, newEps)
+            : trustRegion ? _TrustRegion(eps, init_x, newEps)
+            : _LineSearch(eps, init_x, coef, newEps);
+
+         if (!accepted && !fresh)
+         {
+            // Шаг по обновлённой матрице не уменьшает невязку - пробуем ту же итерацию с настоящей
+            refresh = true;
+            it--;
+            continue;
+         }
+
+         if (!accepted)
+         {
+            init_x = _x;
+            if (debugOutput)
+            {
+               std::cout << "Выход по ошибке сходимости - метод пришёл к оптимальной точке\n";
+               std::cout << std::format("\tКоэф. \\beta:{:15.5f}\n\n", coef);
+            }
+
+            _Trace(it, init_x, eps, newEps);
+            return -1;
+         }
+
+         if (jacobianUpdate == JacobianUpdate::Chord)
+         {
+            reused++;
+            refresh = newEps > refreshRatio * eps || (refreshInterval != 0 && reused >= refreshInterval);
+         }
+         else if (jacobianUpdate == JacobianUpdate::Broyden)
+         {
+            refresh = newEps > refreshRatio * eps || !(levenberg || _LeastSquares() ? _BroydenUpdateJacobian(coef)
+               : trustRegion ? _BroydenUpdate(_step, 1, _model)
+               : _BroydenUpdate(_dx_trim, coef, _F));
+         }
+
+         if (andersonDepth != 0)
+         {
+            _Anderson(init_x, newEps);
+         }
+
+         _Trace(it, init_x, eps, newEps);
+
+         _x = init_x;
+         std::swap(_Fx, _Ftrial);
+         eps = newEps;
+
+         if (debugOutput)
+         {
+            std::cout << std::format("Текущая итерация: {:>4}, текущая невязка: {:>10.2e}\n\tТекущая точка:", it, eps);
+            for (size_t i = 0; i < _x.size(); i++)
+            {
+               std::cout << std::format("{0:15.5f}", _x[i]);
+            }
+            std::cout << "\n\tВектор сдвига:";
+            for (size_t i = 0; i < _x.size(); i++)
+            {
+               std::cout << std::format("{0:15.5f}", _dx[i] * coef);
+            }
+            std::cout << std::format("\n\tКоэф. \\beta:{:15.5f}", coef);
+            std::cout << "\n\n";
+         }
+      }
+
+      // Если итераций не было (начальная точка уже решение), в init_x после обмена лежит старый _x
+      init_x = _x;
+
+      if (eps > minEps)
+      {
+         if (debugOutput)
+            std::cout << "Выход по превышению числа итераций\n\n";
+         return -2;
+      }
+
+      if (debugOutput)
+         std::cout << "Выход по достижению требуемой невязки решения\n\n";
+      return it - 1;
+
+
+   }
+   
+
+
+   template <class TFunctions>
+   BasicNewtonsSolver(size_t, size_t, TFunctions) -> BasicNewtonsSolver<TFunctions, TFunctions>;
+
+   // Солвер с функциями и дифференциалами в std::function (инстанцирован в NewtonsSolver.cpp)
+   using NewtonsSolver = BasicNewtonsSolver<
+      std::function<double(size_t, const std::vector<double>&)>,
+      std::function<double(size_t, size_t, const std::vector<double>&)>>;
 
+   extern template class BasicNewtonsSolver<
+      std::function<double(size_t, const std::vector<double>&)>,
+      std::function<double(size_t, size_t, const std::vector<double>&)>>;
 }
\ No newline at end of file
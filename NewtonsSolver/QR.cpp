@@ -0,0 +1,118 @@
+#include "QR.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace Newtons {
+
+   void HouseholderQR::Resize(size_t rows, size_t cols) {
+      if (rows < cols)
+         throw std::runtime_error("QR decomposition needs at least as many rows as columns.");
+
+      _rows = rows;
+      _cols = cols;
+      _a.resize(rows * cols);
+      _tau.resize(cols);
+   }
+
+   void HouseholderQR::Decompose() {
+      for (size_t k = 0; k < _cols; k++)
+      {
+         double* col = _a.data() + k * _rows;
+
+         double norm = 0;
+         for (size_t i = k; i < _rows; i++)
+         {
+            norm += col[i] * col[i];
+         }
+         norm = std::sqrt(norm);
+         if (norm == 0)
+         {
+            // Столбец уже нулевой, R_kk = 0
+            _tau[k] = 0;
+            continue;
+         }
+
+         // Отражение переводит столбец в alpha * e_k, знак alpha - против col[k], чтобы не вычитать близкие числа
+         double alpha = col[k] > 0 ? -norm : norm;
+         double v0 = col[k] - alpha;
+         for (size_t i = k + 1; i < _rows; i++)
+         {
+            col[i] /= v0;
+         }
+         _tau[k] = -v0 / alpha;
+         col[k] = alpha;
+
+         // Применяем отражение к оставшимся столбцам
+         for (size_t j = k + 1; j < _cols; j++)
+         {
+            double* other = _a.data() + j * _rows;
+            double w = other[k];
+            for (size_t i = k + 1; i < _rows; i++)
+            {
+               w += col[i] * other[i];
+            }
+            w *= _tau[k];
+            other[k] -= w;
+            for (size_t i = k + 1; i < _rows; i++)
+            {
+               other[i] -= w * col[i];
+            }
+         }
+      }
+   }
+
+   void HouseholderQR::_Reflect(size_t k, std::vector<double>& b) const {
+      const double* col = _a.data() + k * _rows;
+      double w = b[k];
+      for (size_t i = k + 1; i < _rows; i++)
+      {
+         w += col[i] * b[i];
+      }
+      w *= _tau[k];
+      b[k] -= w;
+      for (size_t i = k + 1; i < _rows; i++)
+      {
+         b[i] -= w * col[i];
+      }
+   }
+
+   void HouseholderQR::MultiplyQt(std::vector<double>& b) const {
+      for (size_t k = 0; k < _cols; k++)
+      {
+         _Reflect(k, b);
+      }
+   }
+
+   void HouseholderQR::MultiplyQ(std::vector<double>& b) const {
+      for (size_t k = _cols; k-- > 0; )
+      {
+         _Reflect(k, b);
+      }
+   }
+
+   void HouseholderQR::SolveR(std::vector<double>& b) const {
+      for (size_t i = _cols; i-- > 0; )
+      {
+         double sum = b[i];
+         for (size_t j = i + 1; j < _cols; j++)
+         {
+            sum -= (*this)(i, j) * b[j];
+         }
+         b[i] = sum / (*this)(i, i);
+      }
+   }
+
+   void HouseholderQR::SolveRt(std::vector<double>& b) const {
+      // Столбец j матрицы R - строка j матрицы R^T, он лежит в памяти подряд
+      for (size_t j = 0; j < _cols; j++)
+      {
+         const double* col = _a.data() + j * _rows;
+         double sum = b[j];
+         for (size_t i = 0; i < j; i++)
+         {
+            sum -= col[i] * b[i];
+         }
+         b[j] = sum / col[j];
+      }
+   }
+}
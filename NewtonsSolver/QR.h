@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace Newtons {
+
+   /// <summary>
+   /// QR-разложение отражениями Хаусхолдера матрицы rows x cols (rows >= cols).
+   /// Матрица хранится по столбцам: отражение k работает со столбцами k ... cols - 1 подряд
+   /// в памяти. После разложения над диагональю и на ней лежит R, под диагональю - векторы
+   /// отражений v_k (v_k[k] = 1 не хранится), Q = H_0 H_1 ... H_{cols-1}, H_k = I - tau_k v_k v_k^T.
+   /// Используется для задач наименьших квадратов, когда матрица Якоби не квадратная.
+   /// </summary>
+   class HouseholderQR {
+   private:
+
+      size_t _rows = 0;
+      size_t _cols = 0;
+      std::vector<double> _a;
+      std::vector<double> _tau;
+
+      // b = H_k b
+      void _Reflect(size_t k, std::vector<double>& b) const;
+
+   public:
+
+      // Задаёт размер матрицы, память перевыделяется только при увеличении
+      void Resize(size_t rows, size_t cols);
+
+      size_t Rows() const {
+         return _rows;
+      }
+
+      size_t Cols() const {
+         return _cols;
+      }
+
+      double& operator()(size_t i, size_t j) {
+         return _a[i + j * _rows];
+      }
+
+      double operator()(size_t i, size_t j) const {
+         return _a[i + j * _rows];
+      }
+
+      // Раскладывает записанную матрицу на месте
+      void Decompose();
+
+      // b = Q^T b, b - размера Rows()
+      void MultiplyQt(std::vector<double>& b) const;
+
+      // b = Q b, b - размера Rows()
+      void MultiplyQ(std::vector<double>& b) const;
+
+      // Решает R x = b для первых Cols() элементов b, решение записывает на их место
+      void SolveR(std::vector<double>& b) const;
+
+      // Решает R^T x = b для первых Cols() элементов b, решение записывает на их место
+      void SolveRt(std::vector<double>& b) const;
+   };
+}
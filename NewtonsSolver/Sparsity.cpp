@@ -0,0 +1,152 @@
+#include "Sparsity.h"
+#include <algorithm>
+
+namespace Newtons {
+
+   JacobianSparsity::JacobianSparsity(size_t funcCount, size_t variableCount, const std::vector<std::vector<size_t>>& rowCols)
+      : funcCount(funcCount), varCount(variableCount)
+   {
+      if (rowCols.size() != funcCount)
+         throw std::runtime_error("Sparsity pattern should have a row for every function.");
+
+      // Хранение по строкам, номера столбцов в строке упорядочены и не повторяются
+      rowBegin.resize(funcCount + 1);
+      rowBegin[0] = 0;
+      for (size_t func = 0; func < funcCount; func++)
+      {
+         size_t begin = cols.size();
+         for (size_t var : rowCols[func])
+         {
+            if (var >= variableCount)
+               throw std::runtime_error("Sparsity pattern refers to a variable out of range.");
+            cols.push_back(var);
+         }
+         std::sort(cols.begin() + begin, cols.end());
+         cols.erase(std::unique(cols.begin() + begin, cols.end()), cols.end());
+         rowBegin[func + 1] = cols.size();
+      }
+
+      // Хранение по столбцам
+      colBegin.assign(variableCount + 1, 0);
+      for (size_t var : cols)
+      {
+         colBegin[var + 1]++;
+      }
+      for (size_t var = 0; var < variableCount; var++)
+      {
+         colBegin[var + 1] += colBegin[var];
+      }
+
+      colRows.resize(cols.size());
+      colPos.resize(cols.size());
+      std::vector<size_t> next(colBegin.begin(), colBegin.end() - 1);
+      for (size_t func = 0; func < funcCount; func++)
+      {
+         for (size_t k = rowBegin[func]; k < rowBegin[func + 1]; k++)
+         {
+            size_t pos = next[cols[k]]++;
+            colRows[pos] = func;
+            colPos[pos] = k;
+         }
+      }
+   }
+
+   bool JacobianSparsity::Contains(size_t func, size_t var) const {
+      return std::binary_search(cols.begin() + rowBegin[func], cols.begin() + rowBegin[func + 1], var);
+   }
+
+   std::vector<size_t> JacobianSparsity::ProfileFirst() const {
+      if (funcCount != varCount)
+         throw std::runtime_error("Profile matrix can be made only for square Jacobian.");
+
+      // Профиль строки i начинается с самого левого ненулевого элемента строки i или столбца i
+      std::vector<size_t> first(funcCount);
+      for (size_t i = 0; i < funcCount; i++)
+      {
+         first[i] = i;
+      }
+      for (size_t func = 0; func < funcCount; func++)
+      {
+         for (size_t k = rowBegin[func]; k < rowBegin[func + 1]; k++)
+         {
+            size_t var = cols[k];
+            size_t i = std::max(func, var);
+            first[i] = std::min(first[i], std::min(func, var));
+         }
+      }
+
+      return first;
+   }
+
+   size_t JacobianSparsity::ProfileSize() const {
+      std::vector<size_t> first = ProfileFirst();
+      size_t size = 0;
+      for (size_t i = 0; i < first.size(); i++)
+      {
+         size += i - first[i];
+      }
+      return size;
+   }
+
+   void JacobianSparsity::MakeProfile(ProfileMatrix& mat) const {
+      mat.MakeProfile(ProfileFirst());
+   }
+
+   ColumnColoring ColorColumns(const JacobianSparsity& sparsity) {
+      size_t n = sparsity.varCount;
+      std::vector<size_t> color(n);
+
+      // forbidden[c] == var + 1 означает, что цвет c уже занят соседом столбца var
+      std::vector<size_t> forbidden;
+      size_t colorCount = 0;
+
+      for (size_t var = 0; var < n; var++)
+      {
+         for (size_t p = sparsity.colBegin[var]; p < sparsity.colBegin[var + 1]; p++)
+         {
+            size_t func = sparsity.colRows[p];
+            for (size_t k = sparsity.rowBegin[func]; k < sparsity.rowBegin[func + 1]; k++)
+            {
+               size_t other = sparsity.cols[k];
+               if (other < var)
+               {
+                  forbidden[color[other]] = var + 1;
+               }
+            }
+         }
+
+         size_t c = 0;
+         while (c < colorCount && forbidden[c] == var + 1)
+         {
+            c++;
+         }
+         if (c == colorCount)
+         {
+            colorCount++;
+            forbidden.push_back(0);
+         }
+         color[var] = c;
+      }
+
+      ColumnColoring coloring;
+      coloring.colorCount = colorCount;
+      coloring.colorBegin.assign(colorCount + 1, 0);
+      for (size_t var = 0; var < n; var++)
+      {
+         coloring.colorBegin[color[var] + 1]++;
+      }
+      for (size_t c = 0; c < colorCount; c++)
+      {
+         coloring.colorBegin[c + 1] += coloring.colorBegin[c];
+      }
+
+      coloring.columns.resize(n);
+      std::vector<size_t> next(coloring.colorBegin.begin(), coloring.colorBegin.end() - 1);
+      for (size_t var = 0; var < n; var++)
+      {
+         coloring.columns[next[color[var]]++] = var;
+      }
+
+      return coloring;
+   }
+}
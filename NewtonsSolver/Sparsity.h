@@ -0,0 +1,153 @@
+#pragma once
+#include "LU solver/headers/ProfileMatrix.h"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace Newtons {
+
+   // Структура ненулевых элементов матрицы Якоби: для каждой функции - номера переменных,
+   // от которых она зависит. Хранится по строкам (rowBegin, cols) и по столбцам (colBegin,
+   // colRows и colPos - номер элемента в хранении по строкам)
+   class JacobianSparsity {
+   public:
+
+      size_t funcCount = 0;
+      size_t varCount = 0;
+
+      std::vector<size_t> rowBegin;
+      std::vector<size_t> cols;
+
+      std::vector<size_t> colBegin;
+      std::vector<size_t> colRows;
+      std::vector<size_t> colPos;
+
+   public:
+
+      JacobianSparsity() {}
+
+      /// <summary>
+      /// Инициализатор структуры матрицы Якоби
+      /// </summary>
+      /// <param name="funcCount"> - количество функций в системе</param>
+      /// <param name="variableCount"> - количество переменных в системе</param>
+      /// <param name="rowCols"> - для каждой функции номера переменных, от которых она зависит</param>
+      JacobianSparsity(size_t funcCount, size_t variableCount, const std::vector<std::vector<size_t>>& rowCols);
+
+      // Число ненулевых элементов
+      size_t NonZeros() const {
+         return cols.size();
+      }
+
+      bool Contains(size_t func, size_t var) const;
+
+      // Для каждой строки квадратной матрицы - номер первого столбца профиля, покрывающего
+      // все ненулевые элементы строки i и столбца i
+      std::vector<size_t> ProfileFirst() const;
+
+      // Число элементов профиля под диагональю (размер al и au в ProfileMatrix)
+      size_t ProfileSize() const;
+
+      // Задаёт профиль квадратной матрицы mat так, чтобы он покрывал все ненулевые элементы,
+      // и заполняет матрицу нулями
+      void MakeProfile(ProfileMatrix& mat) const;
+   };
+
+   // Способ поиска структуры матрицы Якоби по функциям системы
+   // - NaN - переменная по очереди заменяется на NaN, зависимыми считаются функции, ставшие NaN
+   //   (n вычислений функций, но зависимости только через сравнения и ветвления не находятся)
+   // - Perturbation - переменная по очереди сдвигается на случайный шаг в нескольких случайных
+   //   точках около x, зависимыми считаются функции, значение которых изменилось
+   enum class SparsityProbe {
+      NaN,
+      Perturbation
+   };
+
+   /// <summary>
+   /// Находит структуру матрицы Якоби, вычисляя функции системы около точки x
+   /// </summary>
+   /// <param name="evaluate"> - функция void(const std::vector&lt;double&gt;&amp; x, std::vector&lt;double&gt;&amp; F),
+   /// считающая все функции системы</param>
+   /// <param name="funcCount"> - количество функций в системе</param>
+   /// <param name="variableCount"> - количество переменных в системе</param>
+   /// <param name="x"> - точка, около которой ищется структура</param>
+   /// <param name="probe"> - способ поиска</param>
+   /// <param name="probes"> - число случайных точек для Perturbation, (probes * (n + 1) вычислений функций)</param>
+   template <class TEvaluate>
+   JacobianSparsity DetectSparsity(
+      TEvaluate&& evaluate,
+      size_t funcCount,
+      size_t variableCount,
+      const std::vector<double>& x,
+      SparsityProbe probe = SparsityProbe::Perturbation,
+      size_t probes = 2)
+   {
+      std::vector<std::vector<size_t>> rowCols(funcCount);
+      std::vector<double> base(x), point(variableCount), F0(funcCount), F(funcCount);
+
+      // Фиксированное зерно: структура для одной и той же задачи находится одинаково
+      std::mt19937_64 random(0x5eed);
+      std::uniform_real_distribution<double> unit(0.5, 1.5);
+
+      auto compare = [&](size_t var, bool depends(double, double)) {
+         for (size_t func = 0; func < funcCount; func++)
+         {
+            if (depends(F0[func], F[func]) && (rowCols[func].empty() || rowCols[func].back() != var))
+            {
+               rowCols[func].push_back(var);
+            }
+         }
+      };
+
+      if (probe == SparsityProbe::NaN)
+      {
+         point = x;
+         for (size_t var = 0; var < variableCount; var++)
+         {
+            point[var] = std::numeric_limits<double>::quiet_NaN();
+            evaluate(point, F);
+            point[var] = x[var];
+            compare(var, [](double, double f) { return std::isnan(f); });
+         }
+      }
+      else
+      {
+         for (size_t p = 0; p < probes; p++)
+         {
+            // Случайная точка около x, чтобы не принять случайно нулевую производную за структурный ноль
+            for (size_t var = 0; var < variableCount; var++)
+            {
+               base[var] = x[var] + 1e-3 * (unit(random) - 1.0) * std::max(std::abs(x[var]), 1.0);
+            }
+            evaluate(base, F0);
+
+            point = base;
+            for (size_t var = 0; var < variableCount; var++)
+            {
+               point[var] = base[var] + 1e-3 * unit(random) * std::max(std::abs(base[var]), 1.0);
+               evaluate(point, F);
+               point[var] = base[var];
+
+               // NaN != NaN, поэтому функции, не определённые в точке, считаются зависимыми
+               compare(var, [](double f0, double f) { return f0 != f; });
+            }
+         }
+      }
+
+      return JacobianSparsity(funcCount, variableCount, rowCols);
+   }
+
+   // Раскраска столбцов по Curtis-Powell-Reid: у столбцов одного цвета нет общих строк,
+   // поэтому их можно сдвинуть одновременно и получить все столбцы группы за одно вычисление функций
+   struct ColumnColoring {
+      size_t colorCount = 0;
+
+      // Столбцы, сгруппированные по цветам: цвет c - это columns[colorBegin[c]] ... columns[colorBegin[c + 1] - 1]
+      std::vector<size_t> colorBegin;
+      std::vector<size_t> columns;
+   };
+
+   // Жадная раскраска столбцов в естественном порядке (для ленточных матриц число цветов равно ширине ленты)
+   ColumnColoring ColorColumns(const JacobianSparsity& sparsity);
+}
@@ -0,0 +1,144 @@
+#include "Symbolic.h"
+#include <algorithm>
+
+namespace Newtons {
+
+   void Differentiate(ExprGraph& graph, std::uint32_t var, std::uint32_t last, std::vector<std::uint32_t>& d) {
+      d.resize(last + 1);
+      std::uint32_t zero = graph.Const(0);
+      std::uint32_t one = graph.Const(1);
+
+      auto add = [&](std::uint32_t a, std::uint32_t b) { return graph.Add(ExprOp::Add, a, b); };
+      auto sub = [&](std::uint32_t a, std::uint32_t b) { return graph.Add(ExprOp::Sub, a, b); };
+      auto mul = [&](std::uint32_t a, std::uint32_t b) { return graph.Add(ExprOp::Mul, a, b); };
+      auto div = [&](std::uint32_t a, std::uint32_t b) { return graph.Add(ExprOp::Div, a, b); };
+
+      // Аргументы узла записаны раньше него, поэтому их производные уже известны
+      for (std::uint32_t i = 0; i <= last; i++)
+      {
+         // Узлы графа могут переехать при добавлении новых, поэтому копия
+         ExprNode node = graph.nodes[i];
+         if (node.op == ExprOp::Const)
+         {
+            d[i] = zero;
+            continue;
+         }
+         if (node.op == ExprOp::Var)
+         {
+            d[i] = node.a == var ? one : zero;
+            continue;
+         }
+
+         std::uint32_t a = node.a, b = node.b;
+         std::uint32_t da = d[a];
+         std::uint32_t db = node.op < ExprOp::Neg ? d[b] : zero;
+         if (da == zero && db == zero)
+         {
+            d[i] = zero;
+            continue;
+         }
+
+         switch (node.op)
+         {
+         case ExprOp::Add: d[i] = add(da, db); break;
+         case ExprOp::Sub: d[i] = sub(da, db); break;
+         case ExprOp::Mul: d[i] = add(mul(da, b), mul(a, db)); break;
+         case ExprOp::Div: d[i] = div(sub(da, mul(i, db)), b); break;
+         case ExprOp::Pow:
+            if (db == zero)
+            {
+               // (a^c)' = c * a^(c - 1) * a'
+               std::uint32_t c = b;
+               d[i] = mul(mul(c, graph.Add(ExprOp::Pow, a, sub(c, one))), da);
+            }
+            else
+            {
+               // (a^b)' = a^b * (b' * ln(a) + b * a' / a)
+               d[i] = mul(i, add(mul(db, graph.Add(ExprOp::Log, a)), div(mul(b, da), a)));
+            }
+            break;
+         case ExprOp::Atan2:
+            d[i] = div(sub(mul(b, da), mul(a, db)), add(mul(a, a), mul(b, b)));
+            break;
+         case ExprOp::Neg: d[i] = graph.Add(ExprOp::Neg, da); break;
+         case ExprOp::Sqrt: d[i] = div(da, add(i, i)); break;
+         case ExprOp::Exp: d[i] = mul(i, da); break;
+         case ExprOp::Log: d[i] = div(da, a); break;
+         case ExprOp::Sin: d[i] = mul(graph.Add(ExprOp::Cos, a), da); break;
+         case ExprOp::Cos: d[i] = graph.Add(ExprOp::Neg, mul(graph.Add(ExprOp::Sin, a), da)); break;
+         case ExprOp::Tan: d[i] = mul(add(one, mul(i, i)), da); break;
+         case ExprOp::Asin: d[i] = div(da, graph.Add(ExprOp::Sqrt, sub(one, mul(a, a)))); break;
+         case ExprOp::Acos: d[i] = graph.Add(ExprOp::Neg, div(da, graph.Add(ExprOp::Sqrt, sub(one, mul(a, a))))); break;
+         case ExprOp::Atan: d[i] = div(da, add(one, mul(a, a))); break;
+         case ExprOp::Sinh: d[i] = mul(graph.Add(ExprOp::Cosh, a), da); break;
+         case ExprOp::Cosh: d[i] = mul(graph.Add(ExprOp::Sinh, a), da); break;
+         case ExprOp::Tanh: d[i] = mul(sub(one, mul(i, i)), da); break;
+         // |a|' = a / |a| * a'
+         case ExprOp::Abs: d[i] = mul(div(a, i), da); break;
+         default: d[i] = zero; break;
+         }
+      }
+   }
+
+   SymbolicJacobian::SymbolicJacobian(const ExpressionSystem& system)
+      : _varCount(system.VarCount()), _funcCount(system.FuncCount()),
+        _graph(system.graph), _equations(system.equations)
+   {
+      std::uint32_t last = *std::max_element(_equations.begin(), _equations.end());
+      std::uint32_t zero = _graph.Const(0);
+
+      // Производные всех функций по одной переменной за один проход по графу
+      std::vector<std::vector<std::uint32_t>> columns(_varCount, std::vector<std::uint32_t>(_funcCount));
+      std::vector<std::uint32_t> d;
+      for (std::uint32_t var = 0; var < _varCount; var++)
+      {
+         Differentiate(_graph, var, last, d);
+         for (size_t func = 0; func < _funcCount; func++)
+         {
+            columns[var][func] = d[_equations[func]];
+         }
+      }
+
+      std::vector<std::vector<size_t>> rowCols(_funcCount);
+      for (size_t func = 0; func < _funcCount; func++)
+      {
+         for (size_t var = 0; var < _varCount; var++)
+         {
+            if (columns[var][func] != zero)
+            {
+               rowCols[func].push_back(var);
+               _entries.push_back(columns[var][func]);
+            }
+         }
+      }
+      _sparsity = JacobianSparsity(_funcCount, _varCount, rowCols);
+
+      std::vector<std::uint32_t> outputs(_equations);
+      outputs.insert(outputs.end(), _entries.begin(), _entries.end());
+      _residual = ExprProgram(_graph, _varCount, _equations);
+      _fused = ExprProgram(_graph, _varCount, outputs);
+   }
+
+   void SymbolicJacobian::operator()(const double* x, double* F, double* J) const {
+      if (!J)
+      {
+         _residual.Evaluate(x, F);
+         return;
+      }
+
+      thread_local std::vector<double> values;
+      values.resize(_funcCount + _entries.size());
+      _fused.Evaluate(x, values.data());
+
+      std::copy(values.begin(), values.begin() + _funcCount, F);
+      std::fill(J, J + _funcCount * _varCount, 0.0);
+      const double* entries = values.data() + _funcCount;
+      for (size_t func = 0; func < _funcCount; func++)
+      {
+         for (size_t k = _sparsity.rowBegin[func]; k < _sparsity.rowBegin[func + 1]; k++)
+         {
+            J[func * _varCount + _sparsity.cols[k]] = entries[k];
+         }
+      }
+   }
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "Expression.h"
+#include "Sparsity.h"
+
+namespace Newtons {
+
+   // Производные узлов графа по переменной var: d[i] - узел производной узла i для i <= last.
+   // Узлы производных добавляются в тот же граф и упрощаются при добавлении, нулевые производные -
+   // узел-константа 0
+   void Differentiate(ExprGraph& graph, std::uint32_t var, std::uint32_t last, std::vector<std::uint32_t>& d);
+
+   /// <summary>
+   /// Символьная матрица Якоби системы, заданной текстом. Производные строятся в одном графе
+   /// с функциями системы, поэтому общие подвыражения функций и всех элементов матрицы
+   /// (включая сами функции, которые часто входят в производные) вычисляются один раз.
+   /// Всё вместе компилируется в одну программу. Ненулевые элементы матрицы задают её структуру.
+   /// Объект считает и функции, и матрицу Якоби (void(const double* x, double* F, double* J)),
+   /// поэтому его можно передать солверу одной функцией.
+   /// </summary>
+   class SymbolicJacobian {
+   private:
+
+      size_t _varCount;
+      size_t _funcCount;
+
+      ExprGraph _graph;
+
+      // Узлы функций и ненулевых элементов матрицы Якоби (в порядке хранения по строкам _sparsity)
+      std::vector<std::uint32_t> _equations;
+      std::vector<std::uint32_t> _entries;
+
+      JacobianSparsity _sparsity;
+
+      // Программа только для функций и программа для функций и всех ненулевых элементов матрицы
+      ExprProgram _residual;
+      ExprProgram _fused;
+
+   public:
+
+      explicit SymbolicJacobian(const ExpressionSystem& system);
+
+      // Структура матрицы Якоби (например, для BasicNewtonsSolver::SetSparsity)
+      const JacobianSparsity& Sparsity() const {
+         return _sparsity;
+      }
+
+      const ExprGraph& Graph() const {
+         return _graph;
+      }
+
+      // Узлы ненулевых элементов матрицы в порядке хранения по строкам Sparsity()
+      const std::vector<std::uint32_t>& Entries() const {
+         return _entries;
+      }
+
+      const std::vector<std::uint32_t>& Equations() const {
+         return _equations;
+      }
+
+      // Программа для функций (выходы 0 ... funcCount - 1) и ненулевых элементов матрицы (далее)
+      const ExprProgram& Program() const {
+         return _fused;
+      }
+
+      // Значения функций F и матрица Якоби J (funcCount x variableCount, по строкам) в точке x,
+      // J может быть nullptr
+      void operator()(const double* x, double* F, double* J) const;
+   };
+}
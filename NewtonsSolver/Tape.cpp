@@ -0,0 +1,129 @@
+#include "Tape.h"
+
+namespace Newtons {
+
+   Tape::Tape(const Tape& other) : _guards(other._guards) {
+      for (size_t i = 0; i < other._size; i++)
+      {
+         const Node& node = other[i];
+         Push(node.op, node.a, node.b, node.c, node.value);
+      }
+   }
+
+   double Tape::_Eval(const Node& node, const double* x) const {
+      if (node.op == Op::Input)
+         return x[node.a];
+
+      double a = _Arg(node, node.a);
+      double b = _Arg(node, node.b);
+      switch (node.op)
+      {
+      case Op::Add: return a + b;
+      case Op::Sub: return a - b;
+      case Op::Mul: return a * b;
+      case Op::Div: return a / b;
+      case Op::Pow: return std::pow(a, b);
+      case Op::Atan2: return std::atan2(a, b);
+      case Op::Neg: return -a;
+      case Op::Sqrt: return std::sqrt(a);
+      case Op::Exp: return std::exp(a);
+      case Op::Log: return std::log(a);
+      case Op::Sin: return std::sin(a);
+      case Op::Cos: return std::cos(a);
+      case Op::Tan: return std::tan(a);
+      case Op::Asin: return std::asin(a);
+      case Op::Acos: return std::acos(a);
+      case Op::Atan: return std::atan(a);
+      case Op::Sinh: return std::sinh(a);
+      case Op::Cosh: return std::cosh(a);
+      case Op::Tanh: return std::tanh(a);
+      case Op::Abs: return std::abs(a);
+      case Op::Less: return a < b;
+      case Op::Greater: return a > b;
+      case Op::LessEq: return a <= b;
+      case Op::GreaterEq: return a >= b;
+      case Op::Equal: return a == b;
+      case Op::NotEqual: return a != b;
+      default: return 0;
+      }
+   }
+
+   bool Tape::Forward(const double* x) {
+      for (size_t i = 0; i < _size; i++)
+      {
+         Node& node = (*this)[i];
+         node.value = _Eval(node, x);
+      }
+
+      for (const auto& [node, result] : _guards)
+      {
+         if (((*this)[node].value != 0) != result)
+            return false;
+      }
+      return true;
+   }
+
+   void Tape::Reverse(std::uint32_t output, std::size_t inputCount, double* gradient) {
+      if (_adjoints.size() < _size)
+      {
+         _adjoints.resize(_size);
+      }
+      std::fill(_adjoints.begin(), _adjoints.begin() + output + 1, 0.0);
+      _adjoints[output] = 1.0;
+
+      // Узлы записаны в порядке вычисления, поэтому всё, от чего зависит output, лежит до него
+      for (size_t i = output + 1; i-- > inputCount; )
+      {
+         double adj = _adjoints[i];
+         if (adj == 0)
+            continue;
+
+         const Node& node = (*this)[i];
+         double a = _Arg(node, node.a);
+         double b = _Arg(node, node.b);
+         double v = node.value;
+
+         // Производные узла по первому и второму аргументам
+         double da = 0, db = 0;
+         switch (node.op)
+         {
+         case Op::Add: da = 1; db = 1; break;
+         case Op::Sub: da = 1; db = -1; break;
+         case Op::Mul: da = b; db = a; break;
+         case Op::Div: da = 1 / b; db = -v / b; break;
+         case Op::Pow:
+            da = b == 0 ? 0 : b * std::pow(a, b - 1);
+            db = node.b == constIndex ? 0 : v * std::log(a);
+            break;
+         case Op::Atan2:
+         {
+            double r2 = a * a + b * b;
+            da = b / r2;
+            db = -a / r2;
+            break;
+         }
+         case Op::Neg: da = -1; break;
+         case Op::Sqrt: da = 0.5 / v; break;
+         case Op::Exp: da = v; break;
+         case Op::Log: da = 1 / a; break;
+         case Op::Sin: da = std::cos(a); break;
+         case Op::Cos: da = -std::sin(a); break;
+         case Op::Tan: da = 1 + v * v; break;
+         case Op::Asin: da = 1 / std::sqrt(1 - a * a); break;
+         case Op::Acos: da = -1 / std::sqrt(1 - a * a); break;
+         case Op::Atan: da = 1 / (1 + a * a); break;
+         case Op::Sinh: da = std::cosh(a); break;
+         case Op::Cosh: da = std::sinh(a); break;
+         case Op::Tanh: da = 1 - v * v; break;
+         case Op::Abs: da = a < 0 ? -1 : 1; break;
+         default: break;
+         }
+
+         if (node.a != constIndex) _adjoints[node.a] += adj * da;
+         if (node.b != constIndex) _adjoints[node.b] += adj * db;
+      }
+
+      std::copy(_adjoints.begin(), _adjoints.begin() + std::min<size_t>(inputCount, output + 1), gradient);
+      std::fill(gradient + std::min<size_t>(inputCount, output + 1), gradient + inputCount, 0.0);
+   }
+}
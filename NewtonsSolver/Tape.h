@@ -0,0 +1,302 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "MathFunctions.h"
+
+namespace Newtons {
+
+   /// <summary>
+   /// Лента для автоматического дифференцирования назад. Пока лента активна (Tape::Active()),
+   /// операции над AVar записываются на неё, после чего градиент любого выхода по всем входам
+   /// находится одним обратным проходом за время порядка одного вычисления функций.
+   /// Узлы хранятся блоками фиксированного размера, которые не освобождаются при Clear(),
+   /// поэтому повторная запись ленты того же размера память не выделяет.
+   /// </summary>
+   class Tape {
+   public:
+
+      enum class Op : std::uint8_t {
+         Input,
+         Add, Sub, Mul, Div, Pow, Atan2,
+         Neg, Sqrt, Exp, Log, Sin, Cos, Tan, Asin, Acos, Atan, Sinh, Cosh, Tanh, Abs,
+         Less, Greater, LessEq, GreaterEq, Equal, NotEqual
+      };
+
+      // Номер аргумента-константы: её значение хранится в поле c узла
+      static constexpr std::uint32_t constIndex = UINT32_MAX;
+
+      struct Node {
+         Op op;
+         std::uint32_t a;
+         std::uint32_t b;
+         double c;
+         double value;
+      };
+
+   private:
+
+      static constexpr std::size_t _blockBits = 12;
+      static constexpr std::size_t _blockSize = std::size_t(1) << _blockBits;
+
+      std::vector<std::unique_ptr<Node[]>> _blocks;
+      std::size_t _size = 0;
+
+      // Условия ветвлений, встреченные при записи (узлы сравнения и их результат)
+      std::vector<std::pair<std::uint32_t, bool>> _guards;
+
+      std::vector<double> _adjoints;
+
+      double _Arg(const Node& node, std::uint32_t arg) const {
+         return arg == constIndex ? node.c : (*this)[arg].value;
+      }
+
+      // Значение узла по значениям аргументов
+      double _Eval(const Node& node, const double* x) const;
+
+   public:
+
+      Tape() {}
+      Tape(const Tape& other);
+      Tape(Tape&&) = default;
+      Tape& operator=(Tape other) {
+         std::swap(_blocks, other._blocks);
+         std::swap(_size, other._size);
+         std::swap(_guards, other._guards);
+         return *this;
+      }
+
+      // Лента, на которую сейчас идёт запись в данном потоке (nullptr - запись не идёт)
+      static Tape*& Active() {
+         thread_local Tape* tape = nullptr;
+         return tape;
+      }
+
+      // Делает ленту активной, пока объект жив, и возвращает прежнюю активную ленту
+      // при выходе из области видимости, в том числе по исключению
+      class Activation {
+      private:
+         Tape* _previous;
+
+      public:
+         explicit Activation(Tape& tape) : _previous(Active()) {
+            Active() = &tape;
+         }
+
+         ~Activation() {
+            Active() = _previous;
+         }
+
+         Activation(const Activation&) = delete;
+         Activation& operator=(const Activation&) = delete;
+      };
+
+      void Clear() {
+         _size = 0;
+         _guards.clear();
+      }
+
+      std::size_t Size() const {
+         return _size;
+      }
+
+      Node& operator[](std::size_t i) {
+         return _blocks[i >> _blockBits][i & (_blockSize - 1)];
+      }
+
+      const Node& operator[](std::size_t i) const {
+         return _blocks[i >> _blockBits][i & (_blockSize - 1)];
+      }
+
+      // Записывает узел, возвращает его номер
+      std::uint32_t Push(Op op, std::uint32_t a, std::uint32_t b, double c, double value) {
+         if (_size == _blocks.size() * _blockSize)
+         {
+            _blocks.push_back(std::make_unique<Node[]>(_blockSize));
+         }
+         (*this)[_size] = Node{ op, a, b, c, value };
+         return static_cast<std::uint32_t>(_size++);
+      }
+
+      // Записывает результат сравнения, от которого зависит ветвление
+      void Guard(std::uint32_t node, bool result) {
+         _guards.emplace_back(node, result);
+      }
+
+      // Пересчитывает значения всех узлов для новых входов x (номер входа хранится в поле a узла Input).
+      // Возвращает false, если хотя бы одно сравнение дало другой результат, то есть функции
+      // пошли бы по другой ветви и ленту нужно записать заново
+      bool Forward(const double* x);
+
+      // Градиент узла output по входам в gradient. Входы должны быть записаны первыми узлами ленты
+      void Reverse(std::uint32_t output, std::size_t inputCount, double* gradient);
+   };
+
+
+   // Активная переменная для автоматического дифференцирования назад
+   struct AVar {
+      double value{};
+      std::uint32_t index = Tape::constIndex;
+
+      AVar() {}
+      AVar(double v) : value(v) {}
+      AVar(double v, std::uint32_t i) : value(v), index(i) {}
+
+      bool IsConst() const {
+         return index == Tape::constIndex;
+      }
+   };
+
+   // Записывает операцию op над a и b с результатом value. Операции над константами не записываются
+   inline AVar _Record(Tape::Op op, const AVar& a, const AVar& b, double value) {
+      Tape* tape = Tape::Active();
+      if (!tape || (a.IsConst() && b.IsConst()))
+         return AVar(value);
+
+      // Хотя бы один аргумент - переменная, значение константного (если есть) хранится в c
+      double c = a.IsConst() ? a.value : b.value;
+      return AVar(value, tape->Push(op, a.index, b.index, c, value));
+   }
+
+   inline AVar _Record(Tape::Op op, const AVar& a, double value) {
+      return _Record(op, a, AVar(0.0), value);
+   }
+
+   inline bool _RecordCompare(Tape::Op op, const AVar& a, const AVar& b, bool result) {
+      Tape* tape = Tape::Active();
+      if (tape && !(a.IsConst() && b.IsConst()))
+      {
+         tape->Guard(_Record(op, a, b, result).index, result);
+      }
+      return result;
+   }
+
+   inline AVar operator+(const AVar& a, const AVar& b) { return _Record(Tape::Op::Add, a, b, a.value + b.value); }
+   inline AVar operator-(const AVar& a, const AVar& b) { return _Record(Tape::Op::Sub, a, b, a.value - b.value); }
+   inline AVar operator*(const AVar& a, const AVar& b) { return _Record(Tape::Op::Mul, a, b, a.value * b.value); }
+   inline AVar operator/(const AVar& a, const AVar& b) { return _Record(Tape::Op::Div, a, b, a.value / b.value); }
+   inline AVar operator+(const AVar& a) { return a; }
+   inline AVar operator-(const AVar& a) { return _Record(Tape::Op::Neg, a, -a.value); }
+
+   inline AVar& operator+=(AVar& a, const AVar& b) { return a = a + b; }
+   inline AVar& operator-=(AVar& a, const AVar& b) { return a = a - b; }
+   inline AVar& operator*=(AVar& a, const AVar& b) { return a = a * b; }
+   inline AVar& operator/=(AVar& a, const AVar& b) { return a = a / b; }
+
+   // Сравнения записываются на ленту, чтобы при повторном проходе заметить смену ветви
+   inline bool operator<(const AVar& a, const AVar& b) { return _RecordCompare(Tape::Op::Less, a, b, a.value < b.value); }
+   inline bool operator>(const AVar& a, const AVar& b) { return _RecordCompare(Tape::Op::Greater, a, b, a.value > b.value); }
+   inline bool operator<=(const AVar& a, const AVar& b) { return _RecordCompare(Tape::Op::LessEq, a, b, a.value <= b.value); }
+   inline bool operator>=(const AVar& a, const AVar& b) { return _RecordCompare(Tape::Op::GreaterEq, a, b, a.value >= b.value); }
+   inline bool operator==(const AVar& a, const AVar& b) { return _RecordCompare(Tape::Op::Equal, a, b, a.value == b.value); }
+   inline bool operator!=(const AVar& a, const AVar& b) { return _RecordCompare(Tape::Op::NotEqual, a, b, a.value != b.value); }
+
+   inline AVar sqrt(const AVar& a) { return _Record(Tape::Op::Sqrt, a, std::sqrt(a.value)); }
+   inline AVar exp(const AVar& a) { return _Record(Tape::Op::Exp, a, std::exp(a.value)); }
+   inline AVar log(const AVar& a) { return _Record(Tape::Op::Log, a, std::log(a.value)); }
+   inline AVar sin(const AVar& a) { return _Record(Tape::Op::Sin, a, std::sin(a.value)); }
+   inline AVar cos(const AVar& a) { return _Record(Tape::Op::Cos, a, std::cos(a.value)); }
+   inline AVar tan(const AVar& a) { return _Record(Tape::Op::Tan, a, std::tan(a.value)); }
+   inline AVar asin(const AVar& a) { return _Record(Tape::Op::Asin, a, std::asin(a.value)); }
+   inline AVar acos(const AVar& a) { return _Record(Tape::Op::Acos, a, std::acos(a.value)); }
+   inline AVar atan(const AVar& a) { return _Record(Tape::Op::Atan, a, std::atan(a.value)); }
+   inline AVar sinh(const AVar& a) { return _Record(Tape::Op::Sinh, a, std::sinh(a.value)); }
+   inline AVar cosh(const AVar& a) { return _Record(Tape::Op::Cosh, a, std::cosh(a.value)); }
+   inline AVar tanh(const AVar& a) { return _Record(Tape::Op::Tanh, a, std::tanh(a.value)); }
+   inline AVar abs(const AVar& a) { return _Record(Tape::Op::Abs, a, std::abs(a.value)); }
+   inline AVar fabs(const AVar& a) { return abs(a); }
+   inline AVar pow(const AVar& a, const AVar& b) { return _Record(Tape::Op::Pow, a, b, std::pow(a.value, b.value)); }
+   inline AVar atan2(const AVar& y, const AVar& x) { return _Record(Tape::Op::Atan2, y, x, std::atan2(y.value, x.value)); }
+
+
+   /// <summary>
+   /// Матрица Якоби автоматическим дифференцированием назад. Функции задаются шаблоном по типу
+   /// чисел (template &lt;class T&gt; void(const T* x, T* F)) и записываются на ленту на AVar.
+   /// Каждая строка матрицы - один обратный проход по ленте, поэтому метод выгоден, когда
+   /// функций намного меньше, чем переменных. Если ветвления функций при новом x не меняются,
+   /// лента не записывается заново, а только пересчитывается (при replay == true).
+   /// Объект считает и функции, и матрицу Якоби (void(const double* x, double* F, double* J)),
+   /// поэтому его можно передать солверу одной функцией.
+   /// </summary>
+   template <class TFunctions>
+   class TapeJacobian {
+   private:
+
+      TFunctions _functions;
+      size_t _varCount;
+      size_t _funcCount;
+
+      Tape _tape;
+      std::vector<AVar> _x;
+      std::vector<AVar> _F;
+      bool _recorded = false;
+      size_t _recordings = 0;
+
+      void _Record(const double* x) {
+         // Если функции бросят исключение, недописанная лента не должна считаться записанной
+         _recorded = false;
+         _tape.Clear();
+         Tape::Activation activation(_tape);
+         for (size_t var = 0; var < _varCount; var++)
+         {
+            _x[var] = AVar(x[var], _tape.Push(Tape::Op::Input, static_cast<std::uint32_t>(var), Tape::constIndex, 0, x[var]));
+         }
+         _functions(static_cast<const AVar*>(_x.data()), _F.data());
+
+         _recorded = true;
+         _recordings++;
+      }
+
+   public:
+
+      // Пересчитывать записанную ленту вместо повторного вызова функций
+      bool replay = true;
+
+      /// <summary>
+      /// Инициализатор матрицы Якоби автоматическим дифференцированием назад
+      /// </summary>
+      /// <param name="variableCount"> - количество переменных в системе</param>
+      /// <param name="funcCount"> - количество функций в системе</param>
+      /// <param name="functions"> - шаблонная функция, считающая все функции системы</param>
+      TapeJacobian(size_t variableCount, size_t funcCount, TFunctions functions)
+         : _functions(std::move(functions)), _varCount(variableCount), _funcCount(funcCount),
+           _x(variableCount), _F(funcCount) {}
+
+      // Сколько раз лента записывалась заново
+      size_t Recordings() const {
+         return _recordings;
+      }
+
+      // Значения функций F и матрица Якоби J (funcCount x variableCount, по строкам) в точке x,
+      // J может быть nullptr
+      void operator()(const double* x, double* F, double* J) {
+         if (!replay || !_recorded || !_tape.Forward(x))
+         {
+            _Record(x);
+         }
+
+         for (size_t func = 0; func < _funcCount; func++)
+         {
+            F[func] = _F[func].IsConst() ? _F[func].value : _tape[_F[func].index].value;
+         }
+
+         if (!J)
+            return;
+
+         for (size_t func = 0; func < _funcCount; func++)
+         {
+            double* row = J + func * _varCount;
+            if (_F[func].IsConst())
+            {
+               std::fill(row, row + _varCount, 0.0);
+            }
+            else
+            {
+               _tape.Reverse(_F[func].index, _varCount, row);
+            }
+         }
+      }
+   };
+}
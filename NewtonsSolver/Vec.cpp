@@ -0,0 +1,428 @@
+#include "Vec.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define NEWTONS_VEC_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NEWTONS_VEC_SSE2
+#endif
+
+namespace Newtons::Vec {
+
+   namespace {
+
+      // Все ядра ниже суммируют в 4 полосы: полоса k накапливает элементы с номерами i % 4 == k,
+      // а полосы складываются как (s0 + s1) + (s2 + s3). Порядок операций одинаков
+      // для AVX, SSE2 и скалярного варианта, поэтому и результат у них совпадает.
+
+      inline double _Lanes(double s0, double s1, double s2, double s3) {
+         return (s0 + s1) + (s2 + s3);
+      }
+
+      // Сумма l[i] * r[i] по блоку
+      double _DotBlock(const double* l, const double* r, std::size_t n) {
+         std::size_t i = 0;
+         double s[4] = {};
+#if defined(NEWTONS_VEC_AVX)
+         __m256d acc = _mm256_setzero_pd();
+         for (; i + 4 <= n; i += 4)
+         {
+            acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(l + i), _mm256_loadu_pd(r + i)));
+         }
+         _mm256_storeu_pd(s, acc);
+#elif defined(NEWTONS_VEC_SSE2)
+         __m128d acc0 = _mm_setzero_pd();
+         __m128d acc1 = _mm_setzero_pd();
+         for (; i + 4 <= n; i += 4)
+         {
+            acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(l + i), _mm_loadu_pd(r + i)));
+            acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(l + i + 2), _mm_loadu_pd(r + i + 2)));
+         }
+         _mm_storeu_pd(s, acc0);
+         _mm_storeu_pd(s + 2, acc1);
+#else
+         for (; i + 4 <= n; i += 4)
+         {
+            s[0] += l[i] * r[i];
+            s[1] += l[i + 1] * r[i + 1];
+            s[2] += l[i + 2] * r[i + 2];
+            s[3] += l[i + 3] * r[i + 3];
+         }
+#endif
+         for (std::size_t k = 0; i < n; i++, k++)
+         {
+            s[k] += l[i] * r[i];
+         }
+         return _Lanes(s[0], s[1], s[2], s[3]);
+      }
+
+      // Сумма (scale[i] * v[i])^2 по блоку
+      double _ScaledSqrBlock(const double* scale, const double* v, std::size_t n) {
+         std::size_t i = 0;
+         double s[4] = {};
+#if defined(NEWTONS_VEC_AVX)
+         __m256d acc = _mm256_setzero_pd();
+         for (; i + 4 <= n; i += 4)
+         {
+            __m256d t = _mm256_mul_pd(_mm256_loadu_pd(scale + i), _mm256_loadu_pd(v + i));
+            acc = _mm256_add_pd(acc, _mm256_mul_pd(t, t));
+         }
+         _mm256_storeu_pd(s, acc);
+#elif defined(NEWTONS_VEC_SSE2)
+         __m128d acc0 = _mm_setzero_pd();
+         __m128d acc1 = _mm_setzero_pd();
+         for (; i + 4 <= n; i += 4)
+         {
+            __m128d t0 = _mm_mul_pd(_mm_loadu_pd(scale + i), _mm_loadu_pd(v + i));
+            __m128d t1 = _mm_mul_pd(_mm_loadu_pd(scale + i + 2), _mm_loadu_pd(v + i + 2));
+            acc0 = _mm_add_pd(acc0, _mm_mul_pd(t0, t0));
+            acc1 = _mm_add_pd(acc1, _mm_mul_pd(t1, t1));
+         }
+         _mm_storeu_pd(s, acc0);
+         _mm_storeu_pd(s + 2, acc1);
+#else
+         for (; i + 4 <= n; i += 4)
+         {
+            for (std::size_t k = 0; k < 4; k++)
+            {
+               double t = scale[i + k] * v[i + k];
+               s[k] += t * t;
+            }
+         }
+#endif
+         for (std::size_t k = 0; i < n; i++, k++)
+         {
+            double t = scale[i] * v[i];
+            s[k] += t * t;
+         }
+         return _Lanes(s[0], s[1], s[2], s[3]);
+      }
+
+      // ans[i] = left[i] + coef * right[i] по блоку, возвращает сумму ans[i]^2
+      double _AxpySqrBlock(const double* left, double coef, const double* right, double* ans, std::size_t n) {
+         std::size_t i = 0;
+         double s[4] = {};
+#if defined(NEWTONS_VEC_AVX)
+         __m256d c = _mm256_set1_pd(coef);
+         __m256d acc = _mm256_setzero_pd();
+         for (; i + 4 <= n; i += 4)
+         {
+            __m256d t = _mm256_add_pd(_mm256_loadu_pd(left + i), _mm256_mul_pd(c, _mm256_loadu_pd(right + i)));
+            _mm256_storeu_pd(ans + i, t);
+            acc = _mm256_add_pd(acc, _mm256_mul_pd(t, t));
+         }
+         _mm256_storeu_pd(s, acc);
+#elif defined(NEWTONS_VEC_SSE2)
+         __m128d c = _mm_set1_pd(coef);
+         __m128d acc0 = _mm_setzero_pd();
+         __m128d acc1 = _mm_setzero_pd();
+         for (; i + 4 <= n; i += 4)
+         {
+            __m128d t0 = _mm_add_pd(_mm_loadu_pd(left + i), _mm_mul_pd(c, _mm_loadu_pd(right + i)));
+            __m128d t1 = _mm_add_pd(_mm_loadu_pd(left + i + 2), _mm_mul_pd(c, _mm_loadu_pd(right + i + 2)));
+            _mm_storeu_pd(ans + i, t0);
+            _mm_storeu_pd(ans + i + 2, t1);
+            acc0 = _mm_add_pd(acc0, _mm_mul_pd(t0, t0));
+            acc1 = _mm_add_pd(acc1, _mm_mul_pd(t1, t1));
+         }
+         _mm_storeu_pd(s, acc0);
+         _mm_storeu_pd(s + 2, acc1);
+#else
+         for (; i + 4 <= n; i += 4)
+         {
+            for (std::size_t k = 0; k < 4; k++)
+            {
+               double t = left[i + k] + coef * right[i + k];
+               ans[i + k] = t;
+               s[k] += t * t;
+            }
+         }
+#endif
+         for (std::size_t k = 0; i < n; i++, k++)
+         {
+            double t = left[i] + coef * right[i];
+            ans[i] = t;
+            s[k] += t * t;
+         }
+         return _Lanes(s[0], s[1], s[2], s[3]);
+      }
+
+
+      // Пул потоков для больших векторов. Создаётся при первом обращении, после чего
+      // запуск задач не выделяет память
+      class _ThreadPool {
+      private:
+         std::vector<std::thread> _threads;
+         std::mutex _mutex;
+         std::condition_variable _start;
+         std::condition_variable _done;
+
+         void (*_func)(void*, std::size_t) = nullptr;
+         void* _context = nullptr;
+         std::size_t _tasks = 0;
+         std::atomic<std::size_t> _next = 0;
+         std::size_t _active = 0;
+         std::size_t _generation = 0;
+         bool _stop = false;
+
+         void _Work() {
+            std::size_t task;
+            while ((task = _next.fetch_add(1)) < _tasks)
+            {
+               _func(_context, task);
+            }
+         }
+
+         void _Loop() {
+            std::size_t generation = 0;
+            while (true)
+            {
+               {
+                  std::unique_lock lock(_mutex);
+                  _start.wait(lock, [&] { return _stop || _generation != generation; });
+                  if (_stop) return;
+                  generation = _generation;
+               }
+
+               _Work();
+
+               std::lock_guard lock(_mutex);
+               if (--_active == 0)
+               {
+                  _done.notify_one();
+               }
+            }
+         }
+
+      public:
+         // Запуски из разных потоков выполняются по очереди
+         std::mutex runMutex;
+
+         explicit _ThreadPool(std::size_t threads) {
+            _threads.reserve(threads);
+            for (std::size_t i = 0; i < threads; i++)
+            {
+               _threads.emplace_back([this] { _Loop(); });
+            }
+         }
+
+         ~_ThreadPool() {
+            {
+               std::lock_guard lock(_mutex);
+               _stop = true;
+            }
+            _start.notify_all();
+            for (auto& thread : _threads)
+            {
+               thread.join();
+            }
+         }
+
+         std::size_t Size() const {
+            return _threads.size() + 1;
+         }
+
+         // Выполняет func(context, task) для task < tasks, вызывающий поток тоже участвует
+         void Run(std::size_t tasks, void (*func)(void*, std::size_t), void* context) {
+            {
+               std::lock_guard lock(_mutex);
+               _func = func;
+               _context = context;
+               _tasks = tasks;
+               _next = 0;
+               _active = _threads.size();
+               _generation++;
+            }
+            _start.notify_all();
+
+            _Work();
+
+            std::unique_lock lock(_mutex);
+            _done.wait(lock, [&] { return _active == 0; });
+         }
+      };
+
+      // Пул с нужным числом потоков. Вызывающий получает свою ссылку на пул: если threadCount
+      // поменяли, новый пул заменяет старый, а старый удаляется, когда его отпустит последний пользователь
+      std::shared_ptr<_ThreadPool> _Pool() {
+         static std::shared_ptr<_ThreadPool> pool;
+         static std::mutex poolMutex;
+
+         std::size_t count = threadCount;
+         std::size_t threads = count != 0 ? count : std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+         std::lock_guard lock(poolMutex);
+         if (!pool || pool->Size() != threads)
+         {
+            pool = std::make_shared<_ThreadPool>(threads - 1);
+         }
+         return pool;
+      }
+
+      bool _IsParallel(std::size_t n) {
+         return n >= parallelThreshold && threadCount != 1;
+      }
+
+      // Вызывает blockFunc(b, begin, size) для всех блоков вектора размера n, при parallel - в нескольких
+      // потоках (каждый поток получает непрерывный набор блоков). Решение о потоках принимает вызывающий
+      // один раз: настройки могут поменяться посреди операции, а функция для одного потока может
+      // быть не готова к параллельному вызову
+      template <class BlockFunc>
+      void _ForBlocks(std::size_t n, bool parallel, BlockFunc&& blockFunc) {
+         std::size_t blocks = (n + blockSize - 1) / blockSize;
+         auto block = [&](std::size_t b) {
+            std::size_t begin = b * blockSize;
+            blockFunc(b, begin, std::min(blockSize, n - begin));
+         };
+
+         if (!parallel)
+         {
+            for (std::size_t b = 0; b < blocks; b++)
+            {
+               block(b);
+            }
+            return;
+         }
+
+         std::shared_ptr<_ThreadPool> pool = _Pool();
+         std::lock_guard lock(pool->runMutex);
+         std::size_t tasks = std::min(pool->Size(), blocks);
+         auto task = [&](std::size_t t) {
+            for (std::size_t b = blocks * t / tasks; b < blocks * (t + 1) / tasks; b++)
+            {
+               block(b);
+            }
+         };
+         pool->Run(tasks, [](void* context, std::size_t t) { (*static_cast<decltype(task)*>(context))(t); }, &task);
+      }
+
+      // Сумма blockSum(begin, size) по всем блокам в порядке их номеров
+      template <class BlockSum>
+      double _Reduce(std::size_t n, BlockSum&& blockSum) {
+         if (!_IsParallel(n))
+         {
+            double res = 0;
+            for (std::size_t begin = 0; begin < n; begin += blockSize)
+            {
+               res += blockSum(begin, std::min(blockSize, n - begin));
+            }
+            return res;
+         }
+
+         // Частичные суммы блоков (буфер растёт только при первом запуске на данном размере)
+         thread_local std::vector<double> buffer;
+         std::vector<double>& partials = buffer;
+         partials.resize((n + blockSize - 1) / blockSize);
+         _ForBlocks(n, true, [&](std::size_t b, std::size_t begin, std::size_t size) {
+            partials[b] = blockSum(begin, size);
+         });
+
+         double res = 0;
+         for (double partial : partials)
+         {
+            res += partial;
+         }
+         return res;
+      }
+   }
+
+
+   double Scalar(const std::vector<double>& l, const std::vector<double>& r) {
+      if (l.size() != r.size()) throw std::runtime_error("Size of vectors not same.");
+
+      return _Reduce(l.size(), [&](std::size_t begin, std::size_t size) {
+         return _DotBlock(l.data() + begin, r.data() + begin, size);
+      });
+   }
+
+   double Norm(const std::vector<double>& vec) {
+      return std::sqrt(Scalar(vec, vec));
+   }
+
+   double ScaledNorm(const std::vector<double>& scale, const std::vector<double>& vec) {
+      if (scale.size() != vec.size()) throw std::runtime_error("Size of vectors not same.");
+
+      return std::sqrt(_Reduce(vec.size(), [&](std::size_t begin, std::size_t size) {
+         return _ScaledSqrBlock(scale.data() + begin, vec.data() + begin, size);
+      }));
+   }
+
+   void AddVec(
+      const std::vector<double>& left,
+      double coef,
+      const std::vector<double>& right,
+      std::vector<double>& ans)
+   {
+      _ForBlocks(right.size(), _IsParallel(right.size()), [&](std::size_t, std::size_t begin, std::size_t size) {
+         for (std::size_t i = begin; i < begin + size; i++)
+         {
+            ans[i] = left[i] + coef * right[i];
+         }
+      });
+   }
+
+   double AddVecNorm(
+      const std::vector<double>& left,
+      double coef,
+      const std::vector<double>& right,
+      std::vector<double>& ans)
+   {
+      return std::sqrt(_Reduce(right.size(), [&](std::size_t begin, std::size_t size) {
+         return _AxpySqrBlock(left.data() + begin, coef, right.data() + begin, ans.data() + begin, size);
+      }));
+   }
+
+   void MultiScalar(
+      const std::vector<std::vector<double>>& vecs,
+      std::size_t count,
+      const std::vector<double>& r,
+      double* res)
+   {
+      // Блок r остаётся в кэше, пока по нему считаются все count скалярных произведений
+      for (std::size_t k = 0; k < count; k++)
+      {
+         res[k] = 0;
+      }
+
+      std::size_t n = r.size();
+      std::size_t blocks = (n + blockSize - 1) / blockSize;
+      if (!_IsParallel(n))
+      {
+         for (std::size_t begin = 0; begin < n; begin += blockSize)
+         {
+            std::size_t size = std::min(blockSize, n - begin);
+            for (std::size_t k = 0; k < count; k++)
+            {
+               res[k] += _DotBlock(vecs[k].data() + begin, r.data() + begin, size);
+            }
+         }
+         return;
+      }
+
+      thread_local std::vector<double> buffer;
+      std::vector<double>& partials = buffer;
+      partials.resize(blocks * count);
+      _ForBlocks(n, true, [&](std::size_t b, std::size_t begin, std::size_t size) {
+         for (std::size_t k = 0; k < count; k++)
+         {
+            partials[b * count + k] = _DotBlock(vecs[k].data() + begin, r.data() + begin, size);
+         }
+      });
+
+      for (std::size_t b = 0; b < blocks; b++)
+      {
+         for (std::size_t k = 0; k < count; k++)
+         {
+            res[k] += partials[b * count + k];
+         }
+      }
+   }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace Newtons {
+
+   // Операции над векторами, используемые в солвере.
+   // Суммирование ведётся блоками по blockSize элементов (внутри блока - в 4 SIMD-полосы),
+   // а суммы блоков складываются всегда в одном и том же порядке. Поэтому результат
+   // не зависит ни от числа потоков, ни от того, включён ли многопоточный режим.
+   namespace Vec {
+
+      // Размер блока суммирования
+      constexpr std::size_t blockSize = 2048;
+
+      // Размер векторов, начиная с которого операции выполняются в несколько потоков.
+      // Настройки можно менять из любого потока, в том числе во время вычислений в других потоках
+      inline std::atomic<std::size_t> parallelThreshold = 1 << 17;
+
+      // Число потоков для больших векторов (0 - по числу ядер процессора)
+      inline std::atomic<std::size_t> threadCount = 0;
+
+      // (l, r)
+      double Scalar(const std::vector<double>& l, const std::vector<double>& r);
+
+      // ||vec||
+      double Norm(const std::vector<double>& vec);
+
+      // ||scale * vec|| (покомпонентное произведение)
+      double ScaledNorm(const std::vector<double>& scale, const std::vector<double>& vec);
+
+      // ans = left + coef * right
+      void AddVec(
+         const std::vector<double>& left,
+         double coef,
+         const std::vector<double>& right,
+         std::vector<double>& ans);
+
+      // ans = left + coef * right, за тот же проход возвращает ||ans||
+      double AddVecNorm(
+         const std::vector<double>& left,
+         double coef,
+         const std::vector<double>& right,
+         std::vector<double>& ans);
+
+      // res[k] = (vecs[k], r) для k < count за один проход по r
+      void MultiScalar(
+         const std::vector<std::vector<double>>& vecs,
+         std::size_t count,
+         const std::vector<double>& r,
+         double* res);
+   }
+}
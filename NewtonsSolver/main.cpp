@@ -1,119 +1,66 @@
 ﻿#include <iostream>
 #include <fstream>
 #include <vector>
+#include <charconv>
+#include <cstring>
 #include "NewtonsSolver.h"
+#include "Symbolic.h"
 #include "GraphicDrawer.h"
 
 using namespace std;
 using NewtonsSolver = Newtons::NewtonsSolver;
 
+constexpr size_t varCount = 2;
+constexpr size_t funcCount = 2;
+
 /// <summary>
-/// Получение функций F_i
+/// Получение всех функций F_i. Функция шаблонная по типу чисел, чтобы производные
+/// считались по ней же автоматически (Newtons::AutoDiffJacobian)
 /// </summary>
-/// <param name="funcNum"> - номер функции для вызова;</param>
-/// <param name="x"> - параметры функции</param>
-/// <returns>Значение функции в точке [x]</returns>
-double F(size_t funcNum, const std::vector<double>& x) {
-   switch (funcNum)
-   {
-      case 0: return pow(x[0] - 2, 2) + pow(x[1], 2) - 4;
-      case 1: return pow(x[0] + 2, 2) + pow(x[1], 2) - 4;
-      //case 2: return x[0];
-      // 
-      //case 0: return sin(x[0])*sin(x[0]) - x[1];
-      //case 1: return 2*exp(x[0]) - x[1] - 5;
-      //case 2: return x[0] * x[0] + pow((x[1] - 2), 2) - 4;
-
-      //case 0: return x[1] + x[0] - 4;
-      //case 1: return x[1] - 2 * x[0];
-      //case 2: return x[1] - x[0] + 4;
-
-      default: throw std::runtime_error("Неправильный номер функции F");
-   }
+/// <param name="x"> - параметры функций;</param>
+/// <param name="F"> - значения функций в точке [x]</param>
+template <class T>
+void Functions(const T* x, T* F) {
+   F[0] = pow(x[0] - 2, 2) + pow(x[1], 2) - 4;
+   F[1] = pow(x[0] + 2, 2) + pow(x[1], 2) - 4;
+   //F[2] = x[0];
+
+   //F[0] = sin(x[0]) * sin(x[0]) - x[1];
+   //F[1] = 2 * exp(x[0]) - x[1] - 5;
+   //F[2] = x[0] * x[0] + pow((x[1] - 2), 2) - 4;
+
+   //F[0] = x[1] + x[0] - 4;
+   //F[1] = x[1] - 2 * x[0];
+   //F[2] = x[1] - x[0] + 4;
 }
 
 /// <summary>
-/// Получение производных функций F_i
+/// Получение функций F_i по одной (для отрисовки)
 /// </summary>
-/// <param name="funcNum"> - номер функции для выбора производной;</param>
-/// <param name="varNum"> - номер параметра, по которому берётся производная;</param>
+/// <param name="funcNum"> - номер функции для вызова;</param>
 /// <param name="x"> - параметры функции</param>
 /// <returns>Значение функции в точке [x]</returns>
-double div_F(size_t funcNum, size_t varNum, const std::vector<double>& x) {
-   switch (funcNum)
-   {
-      case 0:
-      {
-         switch (varNum)
-         {
-            case 0:
-               return 2*sin(x[0])*cos(x[0]);
-            case 1:
-               return -1;
-
-            default: throw std::runtime_error("Неправильный номер параметра функции");
-         }
-      }
-
-
-      case 1:
-      {
-         switch (varNum)
-         {
-            case 0:
-               return 2*exp(x[0]);
-            case 1:
-               return -1;
-
-            default: throw std::runtime_error("Неправильный номер параметра функции");
-         }
-      }
-
-      //case 2:
-      //{
-      //   switch (varNum)
-      //   {
-      //      case 0:
-      //         return 2 * x[0];
-      //      case 1:
-      //         return 2 * x[1] - 4;
-
-      //      default: throw std::runtime_error("Неправильный номер параметра функции");
-      //   }
-      //}
-
-      default: throw std::runtime_error("Неправильный номер функции F");
-   }
-}
-
-double div_F_numeric(size_t funcNum, size_t varNum, const std::vector<double>& vars) {
-   static double step = 1e-7;
-   static vector<double> r;
-   static vector<double> l;
-   r = vars;
-   l = vars;
-   r[varNum] += step;
-   l[varNum] -= step;
+double F(size_t funcNum, const std::vector<double>& x) {
+   if (funcNum >= funcCount) throw std::runtime_error("Неправильный номер функции F");
 
-   return (F(funcNum, r) - F(funcNum, l)) / (2.0 * step);
+   double values[funcCount];
+   Functions(x.data(), values);
+   return values[funcNum];
 }
 
-
-
-int main() {
-   setlocale(LC_ALL, "ru-RU");
-
-   constexpr size_t varCount = 2;
-   constexpr size_t funcCount = 2;
-
-   auto solver = NewtonsSolver(varCount, funcCount, F, div_F_numeric);
-
+/// <summary>
+/// Решает систему, выводит решение и для двумерных задач рисует функции и движение метода
+/// </summary>
+/// <param name="solver"> - солвер системы;</param>
+/// <param name="x"> - начальное приближение;</param>
+/// <param name="funcCount"> - количество функций системы;</param>
+/// <param name="F"> - функции системы по одной (для отрисовки)</param>
+template <class TSolver>
+void SolveAndDraw(TSolver& solver, vector<double> x, size_t funcCount, std::function<double(size_t, const std::vector<double>&)> F) {
    NewtonsSolver::TraceVector traceVector;
    solver.EnableTracing(traceVector);
 
    double eps;
-   vector<double> x = { 4.0, 1.0 };
-
    int a = solver.Solve(x, eps, true);
 
    cout << "Полученное решение:";
@@ -124,7 +71,7 @@ int main() {
    cout << "\n\n";
 
 
-   if (varCount == 2)
+   if (x.size() == 2)
    {
       constexpr size_t width = 800, height = 600;
       constexpr float scale = 0.035f;
@@ -171,4 +118,47 @@ int main() {
       drawer.window.display();
       drawer.AwaitCloseSync();
    }
-}
\ No newline at end of file
+}
+
+int main(int argc, char* argv[]) {
+   setlocale(LC_ALL, "ru-RU");
+
+   // Систему можно задать текстом в файле (путь - первый аргумент, за ним - начальное приближение),
+   // тогда функции и матрица Якоби строятся по нему символьно, без пересборки программы
+   if (argc > 1)
+   {
+      auto system = Newtons::ExpressionSystem::Load(argv[1]);
+      Newtons::SymbolicJacobian jacobian(system);
+
+      auto solver = Newtons::BasicNewtonsSolver(system.VarCount(), system.FuncCount(), jacobian);
+      solver.SetSparsity(jacobian.Sparsity());
+
+      vector<double> x(system.VarCount());
+      for (int i = 2; i < argc && i - 2 < (int)x.size(); i++)
+      {
+         // Разбор без учёта локали: после setlocale std::stod ждал бы запятую вместо точки
+         const char* end = argv[i] + strlen(argv[i]);
+         auto [ptr, error] = from_chars(argv[i], end, x[i - 2]);
+         if (error != errc() || ptr != end)
+            throw std::runtime_error("Неправильное начальное приближение");
+      }
+
+      Newtons::ExprProgram program(system);
+      vector<double> values(system.FuncCount());
+      auto F = [program, values](size_t funcNum, const std::vector<double>& x) mutable {
+         program(x.data(), values.data());
+         return values[funcNum];
+      };
+
+      SolveAndDraw(solver, x, system.FuncCount(), F);
+      return 0;
+   }
+
+   // Матрица Якоби считается автоматическим дифференцированием тех же функций
+   auto functions = [](const auto* x, auto* F) { Functions(x, F); };
+   Newtons::AutoDiffJacobian jacobian(varCount, funcCount, functions);
+
+   auto solver = Newtons::BasicNewtonsSolver(varCount, funcCount, functions, jacobian);
+
+   SolveAndDraw(solver, { 4.0, 1.0 }, funcCount, F);
+}